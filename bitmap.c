@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a uMorse keying bitmap renderer
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bitmap.h"
+#include "emit.h"
+#include "once.h"
+#include "umorse.h"
+
+/**
+ * @brief   Keying bits of all 256 code bytes
+ *
+ * As for text rendering, only the gaps at either end of a byte depend on the
+ * bytes around, the pattern from the first to the last element does not.
+ * Four dahs with element gaps take 15 units, so any pattern fits 16 bits.
+ */
+typedef struct {
+    uint16_t bits;      /**< elements and gaps in between, LSB first */
+    uint8_t len;        /**< units in bits, 0 if no elements */
+    uint8_t lead;       /**< inter char gaps before bits */
+    uint8_t trail;      /**< inter char gaps after bits */
+} _bitmap_entry_t;
+
+static _bitmap_entry_t umorse_bitmap_table[256];
+
+/**
+ * @brief   Bit writer, fills a word and stores it as a whole
+ */
+typedef struct {
+    uint8_t *buf;       /**< output buffer, NULL to count only */
+    size_t len;         /**< length of output buffer in bytes */
+    size_t pos;         /**< bytes stored */
+    uint64_t acc;       /**< pending bits */
+    unsigned n;         /**< number of pending bits */
+} _bitmap_writer_t;
+
+static void _build_bitmap_table(void)
+{
+    for (unsigned b = 0; b < 256; ++b) {
+        _bitmap_entry_t *entry = &umorse_bitmap_table[b];
+        uint8_t pend = 0;
+        entry->bits = 0;
+        entry->len = 0;
+        for (unsigned j = 0; j < 4; ++j) {
+            uint8_t e = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (e == UMORSE_END_CHAR) {
+                ++pend;
+            }
+            else if (e != UMORSE_NUL) {
+                if (entry->len == 0) {
+                    entry->lead = pend;
+                }
+                else {
+                    entry->len += (pend > 0) ? umorse_spaces_count(pend) : 1;
+                }
+                entry->bits |= ((e == UMORSE_DAH) ? 0x7 : 0x1) << entry->len;
+                entry->len += (e == UMORSE_DAH) ? 3 : 1;
+                pend = 0;
+            }
+        }
+        if (entry->len == 0) {
+            entry->lead = pend;
+            pend = 0;
+        }
+        entry->trail = pend;
+    }
+}
+
+static void _init_bitmap_table(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_bitmap_table);
+}
+
+static inline int _store(_bitmap_writer_t *w, unsigned bytes)
+{
+    if (w->buf) {
+        if (w->pos + bytes > w->len) {
+            return -1;
+        }
+        for (unsigned k = 0; k < bytes; ++k) {
+            w->buf[w->pos + k] = (uint8_t)(w->acc >> (8 * k));
+        }
+    }
+    w->pos += bytes;
+    return 0;
+}
+
+static inline int _zeros(_bitmap_writer_t *w, unsigned cnt)
+{
+    w->n += cnt;
+    if (w->n >= 64) {
+        if (_store(w, 8) < 0) {
+            return -1;
+        }
+        w->acc = 0;
+        w->n -= 64;
+    }
+    return 0;
+}
+
+static inline int _ones(_bitmap_writer_t *w, uint16_t bits, unsigned len)
+{
+    w->acc |= (uint64_t)bits << w->n;
+    w->n += len;
+    if (w->n >= 64) {
+        if (_store(w, 8) < 0) {
+            return -1;
+        }
+        w->n -= 64;
+        /* len < 64, thus the shift is within 1 and 63 if bits are left */
+        w->acc = (w->n > 0) ? (uint64_t)bits >> (len - w->n) : 0;
+    }
+    return 0;
+}
+
+int umorse_bitmap(const uint8_t *code, size_t clen, uint8_t *bitmap, size_t blen)
+{
+    _bitmap_writer_t w = { .buf = bitmap, .len = blen, .pos = 0, .acc = 0, .n = 0 };
+    size_t spaces = 0;
+    uint8_t gap = 0;
+
+    _init_bitmap_table();
+    for (size_t i = 0; i < clen; ++i) {
+        const _bitmap_entry_t *entry = &umorse_bitmap_table[code[i]];
+        spaces += entry->lead;
+        if (spaces > 0) {
+            gap = umorse_spaces_count(spaces);
+        }
+        if (entry->len == 0) {
+            continue;
+        }
+        if ((_zeros(&w, gap) < 0) || (_ones(&w, entry->bits, entry->len) < 0)) {
+            return -1;
+        }
+        spaces = entry->trail;
+        /* gap between elements, unless a longer one follows */
+        gap = (spaces > 0) ? umorse_spaces_count(spaces) : 0x1;
+    }
+    if (_zeros(&w, gap) < 0) {
+        return -1;
+    }
+    size_t units = 8 * w.pos + w.n;
+    if ((w.n > 0) && (_store(&w, (w.n + 7) / 8) < 0)) {
+        return -1;
+    }
+    return units;
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse keying bitmap renderer
+ *
+ * Expands aligned or compact code into one bit per dit unit, 1 for key down
+ * and 0 for key up, for outputs shifting out a pattern at a fixed rate,
+ * e.g. by SPI, I2S or DMA. A dit is 1, a dah 111, and gaps are 1, 3, 7 and
+ * 15 units of 0 between elements, characters, words and after a stop, the
+ * same as umorse_timeline with dit units. Bits are packed LSB first, i.e.
+ * bit 0 of the first byte is the first unit.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_BITMAP_H
+#define UMORSE_BITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Number of bytes to hold a bitmap of a given number of units
+ */
+#define UMORSE_BITMAP_BYTES(units)  (((units) + 7) / 8)
+
+/**
+ * @brief   Renders morse code into a keying bitmap
+ *
+ * Call with @p bitmap NULL first to get the exact number of units, and
+ * allocate UMORSE_BITMAP_BYTES of it. Unused bits of the last byte are 0.
+ *
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ * @param[out]  bitmap  Output buffer for the bitmap, may be NULL
+ * @param[in]   blen    Length of output buffer in bytes
+ *
+ * @returns     number of units written, or required if @p bitmap is NULL
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_bitmap(const uint8_t *code, size_t clen, uint8_t *bitmap, size_t blen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_BITMAP_H */
+/** @} */
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @defgroup    umorse_cli
+ * @ingroup     umorse
+ * @brief       Command line encoder and decoder of uMorse
+ *
+ * Encodes text to aligned or compact code or dot-dash text, or decodes code
+ * back to text. Input files are memory mapped and processed block wise, other
+ * input such as pipes is read in blocks; output is written in large blocks.
+ * Memory use does not depend on the input size.
+ *
+ * @{
+ * @file
+ * @brief       Command line tool of uMorse
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "umorse.h"
+
+#ifndef CLI_BLOCK_LEN
+#define CLI_BLOCK_LEN       (1U << 20)  /* input processed at once */
+#endif
+#define CLI_OUT_LEN         (4U * CLI_BLOCK_LEN)
+
+typedef enum {
+    MODE_ALIGNED,
+    MODE_COMPACT,
+    MODE_TEXT,
+    MODE_DECODE,
+} cli_mode_t;
+
+typedef struct {
+    int fd;
+    const uint8_t *map;     /* whole input if mapped, else NULL */
+    size_t size;            /* size of mapped input */
+    size_t pos;             /* position in mapped input */
+    uint8_t *buf;           /* block buffer if read */
+    size_t len;             /* valid bytes in block or mapped block */
+    const uint8_t *block;   /* current block */
+} input_t;
+
+typedef struct {
+    int fd;
+    uint8_t *buf;
+    size_t len;
+} output_t;
+
+static int _flush(output_t *out)
+{
+    size_t pos = 0;
+
+    while (pos < out->len) {
+        ssize_t n = write(out->fd, out->buf + pos, out->len - pos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("write");
+            return -1;
+        }
+        pos += n;
+    }
+    out->len = 0;
+    return 0;
+}
+
+/* makes room for at least len bytes */
+static inline int _reserve(output_t *out, size_t len)
+{
+    if ((CLI_OUT_LEN - out->len) < len) {
+        return _flush(out);
+    }
+    return 0;
+}
+
+static int _input_open(input_t *in, const char *path)
+{
+    struct stat st;
+
+    memset(in, 0, sizeof(*in));
+    in->fd = STDIN_FILENO;
+    if (path && strcmp(path, "-")) {
+        in->fd = open(path, O_RDONLY);
+        if (in->fd < 0) {
+            perror(path);
+            return -1;
+        }
+    }
+    if ((fstat(in->fd, &st) == 0) && S_ISREG(st.st_mode) && (st.st_size > 0)) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, in->fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            in->map = map;
+            in->size = st.st_size;
+            return 0;
+        }
+    }
+    /* pipes, terminals, or mmap failed */
+    in->buf = malloc(CLI_BLOCK_LEN);
+    if (in->buf == NULL) {
+        perror("malloc");
+        return -1;
+    }
+    return 0;
+}
+
+/* returns the next block of input, 0 at end of input and < 0 on error */
+static ssize_t _input_next(input_t *in)
+{
+    if (in->map) {
+        if (in->len > 0) {
+            /* done with previous block, keep page cache from filling up */
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t start = (in->pos - in->len) & ~(page - 1);
+            size_t end = in->pos & ~(page - 1);
+            if (end > start) {
+                madvise((void *)(in->map + start), end - start, MADV_DONTNEED);
+            }
+        }
+        in->block = in->map + in->pos;
+        in->len = in->size - in->pos;
+        if (in->len > CLI_BLOCK_LEN) {
+            in->len = CLI_BLOCK_LEN;
+        }
+        in->pos += in->len;
+        return in->len;
+    }
+    in->len = 0;
+    while (in->len < CLI_BLOCK_LEN) {
+        ssize_t n = read(in->fd, in->buf + in->len, CLI_BLOCK_LEN - in->len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("read");
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        in->len += n;
+    }
+    in->block = in->buf;
+    return in->len;
+}
+
+static void _input_close(input_t *in)
+{
+    if (in->map) {
+        munmap((void *)in->map, in->size);
+    }
+    free(in->buf);
+    if (in->fd != STDIN_FILENO) {
+        close(in->fd);
+    }
+}
+
+static int _render(umorse_renderer_t *r, const uint8_t *code, size_t clen,
+                   output_t *out)
+{
+    while (clen > 0) {
+        size_t used = 0;
+        out->len += umorse_renderer_feed(r, code, clen, &used,
+                                         (char *)out->buf + out->len,
+                                         CLI_OUT_LEN - out->len);
+        code += used;
+        clen -= used;
+        if ((clen > 0) && (_flush(out) < 0)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int _encode(input_t *in, output_t *out, cli_mode_t mode)
+{
+    /* at most 3 bytes per char in aligned mode, plus the final stop */
+    static uint8_t code[3 * CLI_BLOCK_LEN + UMORSE_THRESHOLD];
+    umorse_encoder_t enc;
+    umorse_renderer_t r;
+    ssize_t n;
+
+    umorse_encoder_init(&enc, (mode == MODE_COMPACT) ? UMORSE_CODE_COMPACT
+                                                     : UMORSE_CODE_ALIGNED);
+    umorse_renderer_init(&r);
+    while ((n = _input_next(in)) > 0) {
+        const char *text = (const char *)in->block;
+        if (mode == MODE_TEXT) {
+            int clen = umorse_encoder_feed(&enc, text, n, NULL, code, sizeof(code));
+            if (_render(&r, code, clen, out) < 0) {
+                return -1;
+            }
+            continue;
+        }
+        while (n > 0) {
+            size_t used = 0;
+            out->len += umorse_encoder_feed(&enc, text, n, &used, out->buf + out->len,
+                                            CLI_OUT_LEN - out->len);
+            text += used;
+            n -= used;
+            if ((n > 0) && (_flush(out) < 0)) {
+                return -1;
+            }
+        }
+    }
+    if (n < 0) {
+        return -1;
+    }
+    if (mode == MODE_TEXT) {
+        int clen = umorse_encoder_finish(&enc, code, sizeof(code));
+        if ((_render(&r, code, clen, out) < 0) ||
+            (_reserve(out, UMORSE_RENDER_BYTE_MAX) < 0)) {
+            return -1;
+        }
+        out->len += umorse_renderer_finish(&r, (char *)out->buf + out->len,
+                                           CLI_OUT_LEN - out->len);
+    }
+    else {
+        /* room for the final stop */
+        if (_reserve(out, UMORSE_THRESHOLD) < 0) {
+            return -1;
+        }
+        out->len += umorse_encoder_finish(&enc, out->buf + out->len,
+                                          CLI_OUT_LEN - out->len);
+    }
+    return _flush(out);
+}
+
+static int _decode(input_t *in, output_t *out)
+{
+    umorse_decoder_t dec;
+    ssize_t n;
+
+    umorse_decoder_init(&dec);
+    while ((n = _input_next(in)) > 0) {
+        const uint8_t *code = in->block;
+        while (n > 0) {
+            size_t used = 0;
+            int ret = umorse_decoder_feed(&dec, code, n, &used,
+                                          (char *)out->buf + out->len,
+                                          CLI_OUT_LEN - out->len);
+            if (ret < 0) {
+                fprintf(stderr, "invalid code\n");
+                return -1;
+            }
+            out->len += ret;
+            code += used;
+            n -= used;
+            if ((n > 0) && (_flush(out) < 0)) {
+                return -1;
+            }
+        }
+    }
+    if ((n < 0) || (_reserve(out, UMORSE_DECODE_FINISH) < 0)) {
+        return -1;
+    }
+    int ret = umorse_decoder_finish(&dec, (char *)out->buf + out->len,
+                                    CLI_OUT_LEN - out->len);
+    if (ret < 0) {
+        fprintf(stderr, "invalid code\n");
+        return -1;
+    }
+    out->len += ret;
+    return _flush(out);
+}
+
+static void _usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [-a|-c|-t|-d] [-o output] [input]\n"
+            "  -a  encode to aligned code (default)\n"
+            "  -c  encode to compact code\n"
+            "  -t  encode to dot-dash text\n"
+            "  -d  decode aligned or compact code to text\n"
+            "  -o  write to output file instead of stdout\n"
+            "input defaults to stdin, or use -\n", name);
+}
+
+int main(int argc, char **argv)
+{
+    cli_mode_t mode = MODE_ALIGNED;
+    const char *path = NULL;
+    input_t in;
+    output_t out = { STDOUT_FILENO, NULL, 0 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "actdo:h")) != -1) {
+        switch (opt) {
+            case 'a':
+                mode = MODE_ALIGNED;
+                break;
+            case 'c':
+                mode = MODE_COMPACT;
+                break;
+            case 't':
+                mode = MODE_TEXT;
+                break;
+            case 'd':
+                mode = MODE_DECODE;
+                break;
+            case 'o':
+                path = optarg;
+                break;
+            default:
+                _usage(argv[0]);
+                return (opt == 'h') ? 0 : 2;
+        }
+    }
+    if (argc - optind > 1) {
+        _usage(argv[0]);
+        return 2;
+    }
+    if (path) {
+        out.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (out.fd < 0) {
+            perror(path);
+            return 1;
+        }
+    }
+    out.buf = malloc(CLI_OUT_LEN);
+    if ((out.buf == NULL) || (_input_open(&in, argv[optind]) < 0)) {
+        return 1;
+    }
+    int ret = (mode == MODE_DECODE) ? _decode(&in, &out) : _encode(&in, &out, mode);
+    _input_close(&in);
+    free(out.buf);
+    if (path) {
+        close(out.fd);
+    }
+    return (ret < 0) ? 1 : 0;
+}
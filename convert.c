@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a uMorse transcoder between code layouts
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "convert.h"
+#include "once.h"
+#include "simd.h"
+#include "umorse.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define UMORSE_CONVERT_X86      (1)
+#include <immintrin.h>
+#else
+#define UMORSE_CONVERT_X86      (0)
+#endif
+
+/* low bit of every pair of bits */
+#define UMORSE_CONVERT_LO       (0x5555555555555555ULL)
+
+/**
+ * @brief   Non-NUL elements of all 256 code bytes, squeezed to the LSB
+ */
+typedef struct {
+    uint8_t bits;       /**< elements packed from bit 0 */
+    uint8_t len;        /**< number of valid bits */
+} _squeeze_entry_t;
+
+static _squeeze_entry_t umorse_squeeze_table[256];
+
+/**
+ * @brief   Bit writer, fills a word and stores it as a whole
+ */
+typedef struct {
+    uint8_t *buf;       /**< output buffer, NULL to count only */
+    size_t len;         /**< length of output buffer */
+    size_t pos;         /**< bytes stored */
+    uint64_t acc;       /**< pending bits */
+    unsigned n;         /**< number of pending bits */
+} _convert_writer_t;
+
+static void _build_squeeze_table(void)
+{
+    for (unsigned b = 0; b < 256; ++b) {
+        _squeeze_entry_t *entry = &umorse_squeeze_table[b];
+        entry->bits = 0;
+        entry->len = 0;
+        for (unsigned j = 0; j < 4; ++j) {
+            uint8_t e = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (e != UMORSE_NUL) {
+                entry->bits |= e << entry->len;
+                entry->len += UMORSE_SHIFT;
+            }
+        }
+    }
+}
+
+static void _init_squeeze_table(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_squeeze_table);
+}
+
+static inline int _store(_convert_writer_t *w, uint64_t word, unsigned bytes)
+{
+    if (w->buf) {
+        if (w->pos + bytes > w->len) {
+            return -1;
+        }
+        for (unsigned k = 0; k < bytes; ++k) {
+            w->buf[w->pos + k] = (uint8_t)(word >> (8 * k));
+        }
+    }
+    w->pos += bytes;
+    return 0;
+}
+
+/* appends len bits, 0 to 64 */
+static inline int _put(_convert_writer_t *w, uint64_t bits, unsigned len)
+{
+    if (w->n + len < 64) {
+        w->acc |= bits << w->n;
+        w->n += len;
+        return 0;
+    }
+    uint64_t word = (w->n > 0) ? w->acc | (bits << w->n) : bits;
+    if (_store(w, word, 8) < 0) {
+        return -1;
+    }
+    w->n = w->n + len - 64;
+    w->acc = (w->n > 0) ? bits >> (len - w->n) : 0;
+    return 0;
+}
+
+static inline int _put_byte(_convert_writer_t *w, uint8_t b)
+{
+    const _squeeze_entry_t *entry = &umorse_squeeze_table[b];
+
+    return _put(w, entry->bits, entry->len);
+}
+
+#if UMORSE_CONVERT_X86
+__attribute__((target("bmi2,popcnt")))
+static size_t _squeeze_bmi2(_convert_writer_t *w, const uint8_t *code, size_t clen)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= clen; i += 8) {
+        uint64_t word;
+        memcpy(&word, code + i, sizeof(word));
+        uint64_t lo = (word | (word >> 1)) & UMORSE_CONVERT_LO;
+        uint64_t mask = lo | (lo << 1);
+        if (_put(w, _pext_u64(word, mask), (unsigned)_mm_popcnt_u64(mask)) < 0) {
+            return (size_t)-1;
+        }
+    }
+    return i;
+}
+
+static int _bmi2(void)
+{
+    __builtin_cpu_init();
+    return (umorse_simd_level() != UMORSE_SIMD_NONE) && __builtin_cpu_supports("bmi2");
+}
+#endif
+
+int umorse_convert_compact(const uint8_t *code, size_t clen,
+                           uint8_t *out, size_t olen)
+{
+    _convert_writer_t w = { .buf = out, .len = olen, .pos = 0, .acc = 0, .n = 0 };
+    size_t i = 0;
+
+    _init_squeeze_table();
+#if UMORSE_CONVERT_X86
+    if (_bmi2()) {
+        if ((i = _squeeze_bmi2(&w, code, clen)) == (size_t)-1) {
+            return -1;
+        }
+    }
+#endif
+    for (; i < clen; ++i) {
+        if (_put_byte(&w, code[i]) < 0) {
+            return -1;
+        }
+    }
+    /* pad the last byte with UMORSE_NUL elements */
+    if ((w.n > 0) && (_store(&w, w.acc, (w.n + 7) / 8) < 0)) {
+        return -1;
+    }
+    return w.pos;
+}
+
+/* writes a run of gaps, partial byte first, such that a stop comes last */
+static inline int _put_gaps(_convert_writer_t *w, size_t run)
+{
+    static const uint8_t partial[] = { 0x00, 0x03, 0x0F, 0x3F };
+
+    if ((run % 4) && (_store(w, partial[run % 4], 1) < 0)) {
+        return -1;
+    }
+    for (run /= 4; run > 0; --run) {
+        if (_store(w, UMORSE_END_STOP, 1) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int umorse_convert_aligned(const uint8_t *code, size_t clen,
+                           uint8_t *out, size_t olen)
+{
+    _convert_writer_t w = { .buf = out, .len = olen, .pos = 0, .acc = 0, .n = 0 };
+    /* elements of the current byte, and gaps of the current run */
+    uint8_t cur = 0;
+    unsigned elems = 0;
+    size_t run = 0;
+
+    for (size_t i = 0; i < clen; ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            uint8_t e = (code[i] >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (e == UMORSE_END_CHAR) {
+                if (elems > 0) {
+                    /* the first gap closes the char in its own byte */
+                    if ((_store(&w, cur, 1) < 0) || (_store(&w, UMORSE_END_CHAR, 1) < 0)) {
+                        return -1;
+                    }
+                    cur = 0;
+                    elems = 0;
+                }
+                else {
+                    ++run;
+                }
+            }
+            else if (e != UMORSE_NUL) {
+                if (run > 0) {
+                    if (_put_gaps(&w, run) < 0) {
+                        return -1;
+                    }
+                    run = 0;
+                }
+                if (elems == 4) {
+                    if (_store(&w, cur, 1) < 0) {
+                        return -1;
+                    }
+                    cur = 0;
+                    elems = 0;
+                }
+                cur |= e << (elems * UMORSE_SHIFT);
+                ++elems;
+            }
+        }
+    }
+    if ((elems > 0) && (_store(&w, cur, 1) < 0)) {
+        return -1;
+    }
+    if (_put_gaps(&w, run) < 0) {
+        return -1;
+    }
+    return w.pos;
+}
+
+int umorse_convert(const uint8_t *code, size_t clen,
+                   uint8_t *out, size_t olen, uint8_t flags)
+{
+    if (flags & UMORSE_CODE_DENSE) {
+        return -1;
+    }
+    if (flags & UMORSE_CODE_COMPACT) {
+        return umorse_convert_compact(code, clen, out, olen);
+    }
+    return umorse_convert_aligned(code, clen, out, olen);
+}
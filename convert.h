@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse transcoder between code layouts
+ *
+ * Converts code between aligned and compact mode without going through
+ * text. To compact mode, the UMORSE_NUL pairs aligned code is padded with
+ * are squeezed out, 8 bytes at a time with PEXT on CPUs with BMI2 and by
+ * table otherwise; the result is identical to umorse_encode_compact of the
+ * same text. To aligned mode, characters are split into bytes of up to 4
+ * elements again, each followed by its gap byte. Runs of gaps keep their
+ * length, but spaces and stops within a run may be reordered, which decodes
+ * and outputs the same.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_CONVERT_H
+#define UMORSE_CONVERT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Converts morse code into another layout
+ *
+ * PEXT is used as long as umorse_simd_level is not UMORSE_SIMD_NONE and the
+ * CPU supports BMI2.
+ *
+ * @param[in]   code    Buffer with morse encoded text, in any layout
+ * @param[in]   clen    Length of morse encoded text
+ * @param[out]  out     Output buffer for converted code, may be NULL
+ * @param[in]   olen    Length of output buffer
+ * @param[in]   flags   Layout to convert to, UMORSE_CODE_ALIGNED or
+ *                      UMORSE_CODE_COMPACT
+ *
+ * @returns     length of converted code, or required if @p out is NULL
+ * @returns     < 0 if the output buffer is too small or on dense mode
+ */
+int umorse_convert(const uint8_t *code, size_t clen,
+                   uint8_t *out, size_t olen, uint8_t flags);
+
+/**
+ * @brief   Converts aligned morse code into compact mode
+ *
+ * @see     umorse_convert
+ */
+int umorse_convert_compact(const uint8_t *code, size_t clen,
+                           uint8_t *out, size_t olen);
+
+/**
+ * @brief   Converts compact morse code into aligned mode
+ *
+ * @see     umorse_convert
+ */
+int umorse_convert_aligned(const uint8_t *code, size_t clen,
+                           uint8_t *out, size_t olen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_CONVERT_H */
+/** @} */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Element output shared by all uMorse output paths
+ *
+ * umorse_output, the scheduler and the ring all turn code into the same
+ * calls; the gap lengths and the dispatch of a single element live here
+ * only, such that they cannot drift apart.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+
+#ifndef UMORSE_EMIT_H
+#define UMORSE_EMIT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "stats.h"
+#include "umorse.h"
+
+/**
+ * @brief   Nil count for a number of consecutive inter char gaps
+ *
+ * One gap ends a char, two or three a word, more a stop. The bitmap uses
+ * the same counts as units of silence.
+ */
+static inline uint8_t umorse_spaces_count(size_t spaces)
+{
+    if (spaces > 3) {
+        return 0xF;
+    }
+    else if (spaces > 1) {
+        return 0x7;
+    }
+    else if (spaces > 0) {
+        return 0x3;
+    }
+    return 0;
+}
+
+/**
+ * @brief   Outputs a single element, a span entry of one for batch outputs
+ *
+ * @param[in]   out     Output interface
+ * @param[in]   e       UMORSE_DIT, UMORSE_DAH or UMORSE_SPAN_NIL with count
+ * @param[in]   flags   Flags passed to the callback
+ */
+static inline void umorse_emit(const umorse_out_t *out, uint8_t e, uint8_t flags)
+{
+    UMORSE_STATS_ADD(output_elements, 1);
+    if (out->batch) {
+        UMORSE_STATS_CALL(UMORSE_STATS_BATCH, out->batch(out->params, &e, 1, flags));
+    }
+    else if (e == UMORSE_DIT) {
+        UMORSE_STATS_CALL(UMORSE_STATS_DIT, out->dit(out->params, flags));
+    }
+    else if (e == UMORSE_DAH) {
+        UMORSE_STATS_CALL(UMORSE_STATS_DAH, out->dah(out->params, flags));
+    }
+    else {
+        UMORSE_STATS_CALL(UMORSE_STATS_NIL,
+                          out->nil(out->params, (e & UMORSE_MASK_COUNT) | flags));
+    }
+}
+
+#endif /* UMORSE_EMIT_H */
+/** @} */
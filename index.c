@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a sparse character index of uMorse code
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "index.h"
+#include "umorse.h"
+
+/**
+ * @brief   Scans code from a char start for the start of char number stop
+ *
+ * Chars start with an element after a gap, @p chars counts them.
+ *
+ * @returns     element offset of the char, UMORSE_INDEX_END if not found
+ */
+static size_t _scan(const uint8_t *code, size_t clen, size_t pos,
+                    size_t *chars, size_t stop)
+{
+    /* a char may only start after a gap, or at the start */
+    int gap = 1;
+    size_t end = 4 * clen;
+
+    for (; pos < end; ++pos) {
+        uint8_t e = (code[pos / 4] >> ((pos % 4) * UMORSE_SHIFT)) & UMORSE_MASK;
+        if (e == UMORSE_END_CHAR) {
+            gap = 1;
+        }
+        else if ((e != UMORSE_NUL) && gap) {
+            if (*chars == stop) {
+                return pos;
+            }
+            ++(*chars);
+            gap = 0;
+        }
+    }
+    return UMORSE_INDEX_END;
+}
+
+int umorse_index_build(umorse_index_t *idx, size_t *pos, size_t size,
+                       size_t stride, const uint8_t *code, size_t clen)
+{
+    size_t p = 0;
+    size_t chars = 0;
+    size_t len = 0;
+
+    idx->pos = pos;
+    idx->size = size;
+    idx->stride = stride;
+    idx->chars = 0;
+    if (stride == 0) {
+        return -1;
+    }
+    /* every stride-th char starts the next scan */
+    while ((p = _scan(code, clen, p, &chars, len * stride)) != UMORSE_INDEX_END) {
+        if (len < size) {
+            pos[len] = p;
+        }
+        ++len;
+    }
+    /* chars past the last entry stored are not reachable by seek */
+    idx->chars = (len > size) ? size * stride : chars;
+    return (int)len;
+}
+
+size_t umorse_index_seek(const umorse_index_t *idx, const uint8_t *code,
+                         size_t clen, size_t chr)
+{
+    if ((chr >= idx->chars) || ((chr / idx->stride) >= idx->size)) {
+        return UMORSE_INDEX_END;
+    }
+    size_t chars = chr - (chr % idx->stride);
+    return _scan(code, clen, idx->pos[chr / idx->stride], &chars, chr);
+}
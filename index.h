@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a sparse character index of uMorse code
+ *
+ * Characters of compact code start at any pair of bits, so finding one
+ * takes a scan from the start. The index records the element offset of
+ * every stride-th character, such that umorse_index_seek only scans up to
+ * stride - 1 characters. The stride sets the memory overhead, one size_t
+ * per stride characters. Characters are letters and numbers, i.e. code
+ * words, as gaps do not map back to single input chars. Works for aligned
+ * code as well.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_INDEX_H
+#define UMORSE_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Returned by umorse_index_seek for chars beyond the code
+ */
+#define UMORSE_INDEX_END        ((size_t)-1)
+
+/**
+ * @brief   Sparse character index of a code buffer
+ */
+typedef struct {
+    size_t *pos;        /**< element offset of every stride-th char */
+    size_t size;        /**< capacity of pos */
+    size_t stride;      /**< chars per entry */
+    size_t chars;       /**< number of chars in code */
+} umorse_index_t;
+
+/**
+ * @brief   Builds the index of a code buffer
+ *
+ * Like snprintf, the number of entries the whole code takes is returned
+ * even if @p size is too small. Then @p pos holds the first @p size of
+ * them and idx->chars is limited to the chars they cover, such that seeks
+ * never go beyond the entries stored.
+ *
+ * @param[out]  idx     Index
+ * @param[in]   pos     Storage for entries
+ * @param[in]   size    Number of entries in @p pos
+ * @param[in]   stride  Chars per entry, at least 1
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ *
+ * @returns     number of entries required, the index is partial if it
+ *              exceeds @p size
+ * @returns     < 0 if @p stride is 0
+ */
+int umorse_index_build(umorse_index_t *idx, size_t *pos, size_t size,
+                       size_t stride, const uint8_t *code, size_t clen);
+
+/**
+ * @brief   Finds the first element of a given char
+ *
+ * The result can be passed to umorse_decode_at and umorse_output_at.
+ *
+ * @param[in]   idx     Index of @p code
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ * @param[in]   chr     Number of char, starting at 0
+ *
+ * @returns     element offset in pairs of bits
+ * @returns     UMORSE_INDEX_END if @p chr is beyond the code
+ */
+size_t umorse_index_seek(const umorse_index_t *idx, const uint8_t *code,
+                         size_t clen, size_t chr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_INDEX_H */
+/** @} */
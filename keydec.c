@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of adaptive uMorse decoder for keying events
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "keydec.h"
+#include "stats.h"
+#include "umorse.h"
+
+/* element gaps follow the dit, char and word gaps keep a ratio of 3 to 7 */
+static inline void _set_spaces(umorse_keydec_t *dec)
+{
+    dec->space[0] = dec->mark[0];
+    if (dec->space[1] < 2 * dec->space[0]) {
+        dec->space[1] = 2 * dec->space[0];
+    }
+    dec->space[2] = (uint32_t)(7ULL * dec->space[1] / 3);
+}
+
+void umorse_keydec_init(umorse_keydec_t *dec, uint32_t dit)
+{
+    if (dit == 0) {
+        dit = 1;
+    }
+    dec->mark[0] = dit;
+    dec->mark[1] = 3 * dit;
+    /* between the 3 dits of standard and 4 dits of umorse_output timing */
+    dec->space[1] = 7 * dit / 2;
+    _set_spaces(dec);
+    dec->cc = 0;
+    dec->shift = 0;
+    dec->gap = 2;
+}
+
+/* index of the nearest mean on a log scale, means are sorted ascending */
+static inline unsigned _nearest(const uint32_t *mean, unsigned cnt, uint32_t dur)
+{
+    unsigned k = 0;
+
+    while ((k + 1 < cnt) &&
+           ((uint64_t)dur * dur > (uint64_t)mean[k] * mean[k + 1])) {
+        ++k;
+    }
+    return k;
+}
+
+static inline void _update(uint32_t *mean, unsigned k, uint32_t dur)
+{
+    /* limit the pull of long pauses or carriers */
+    if (dur > 2 * mean[k]) {
+        dur = 2 * mean[k];
+    }
+    if ((3ULL * dur < 2ULL * mean[k]) || (2ULL * dur > 3ULL * mean[k])) {
+        /* far from expected, e.g. on a change of speed, move half way */
+        mean[k] = (uint32_t)(((uint64_t)mean[k] + dur) / 2);
+        return;
+    }
+    int64_t diff = (int64_t)dur - mean[k];
+    mean[k] = (uint32_t)(mean[k] + diff / (1 << UMORSE_KEYDEC_WEIGHT));
+}
+
+static size_t _space(umorse_keydec_t *dec, unsigned k, char *text)
+{
+    size_t tpos = 0;
+
+    if ((k > 0) && (dec->shift > 0)) {
+        /* inter char gap confirmed, emit character */
+        char c = (dec->shift <= UMORSE_DECODE_MAX) ? umorse_decode_char(dec->cc) : 0;
+        if (c) {
+            text[tpos++] = c;
+        }
+        else {
+            UMORSE_STATS_ADD(decode_unknown, 1);
+        }
+        dec->cc = 0;
+        dec->shift = 0;
+        dec->gap = 1;
+    }
+    if ((k > 1) && (dec->gap == 1)) {
+        text[tpos++] = ' ';
+        dec->gap = 2;
+    }
+    return tpos;
+}
+
+int umorse_keydec_put(umorse_keydec_t *dec, umorse_key_t key,
+                      char *text, size_t tlen)
+{
+    uint32_t dur = key & UMORSE_KEY_DURATION;
+
+    if (tlen < 2) {
+        return -1;
+    }
+    if (dur == 0) {
+        return 0;
+    }
+    if (key & UMORSE_KEY_ON) {
+        uint32_t dit = dec->mark[0];
+        uint32_t dah = dec->mark[1];
+        unsigned k = _nearest(dec->mark, 2, dur);
+        _update(dec->mark, k, dur);
+        /* a change in speed moves the other mean with half the ratio */
+        if (k == 0) {
+            dec->mark[1] = (uint32_t)(dah + ((int64_t)dah * dec->mark[0] / dit - dah) / 2);
+        }
+        else {
+            dec->mark[0] = (uint32_t)(dit + ((int64_t)dit * dec->mark[1] / dah - dit) / 2);
+        }
+        /* keep means apart, ratio of dah to dit is at least 2 */
+        if (dec->mark[1] < 2 * dec->mark[0]) {
+            dec->mark[1] = 2 * dec->mark[0];
+        }
+        /* marks set the speed, gaps follow and only adapt their stretch */
+        if (dit > 0) {
+            dec->space[1] = (uint32_t)((uint64_t)dec->space[1] * dec->mark[0] / dit);
+        }
+        _set_spaces(dec);
+        if (dec->shift < UMORSE_DECODE_MAX) {
+            uint8_t e = (k == 0) ? UMORSE_DIT : UMORSE_DAH;
+            dec->cc |= (uint16_t)e << (dec->shift * UMORSE_SHIFT);
+            ++dec->shift;
+        }
+        else {
+            /* code word too long, dropped by the next inter char gap */
+            dec->cc = 0;
+            dec->shift = UMORSE_DECODE_MAX + 1;
+        }
+        return 0;
+    }
+    unsigned k = _nearest(dec->space, 3, dur);
+    if (k == 1) {
+        _update(dec->space, 1, dur);
+        _set_spaces(dec);
+    }
+    return _space(dec, k, text);
+}
+
+int umorse_keydec_idle(umorse_keydec_t *dec, uint32_t dur,
+                       char *text, size_t tlen)
+{
+    if (tlen < 2) {
+        return -1;
+    }
+    return _space(dec, _nearest(dec->space, 3, dur), text);
+}
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of an adaptive uMorse decoder for keying events
+ *
+ * Decodes a stream of key down and key up durations, as umorse_timeline
+ * renders them, into text. The durations of dits and dahs, and of gaps
+ * between elements, characters and words, are tracked online by a running
+ * k-means: each duration is assigned to the nearest mean on a log scale,
+ * which is then moved towards it. Marks set the speed: the gap between
+ * elements equals the dit mean and the other gaps are scaled along with it.
+ * Char gaps only adapt their stretch relative to the dit, e.g. to Farnsworth
+ * timing, and word gaps keep a ratio of 7 to 3 to them. Thereby the decoder
+ * follows speed drift and hand keyed timing without a fixed dit length.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_KEYDEC_H
+#define UMORSE_KEYDEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "umorse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Adaptive decoder parameters
+ * @{
+ */
+#ifndef UMORSE_KEYDEC_WEIGHT
+#define UMORSE_KEYDEC_WEIGHT        (3U)    /**< means move by 1/2^WEIGHT */
+#endif
+/** @} */
+
+/**
+ * @brief   Adaptive key decoder state
+ */
+typedef struct {
+    uint32_t mark[2];   /**< mean duration of dit and dah */
+    uint32_t space[3];  /**< mean duration of element, char and word gaps */
+    uint16_t cc;        /**< elements of the current character */
+    uint8_t shift;      /**< number of elements in cc */
+    uint8_t gap;        /**< 1 after a character, 2 after a word gap */
+} umorse_keydec_t;
+
+/**
+ * @brief   Initializes an adaptive key decoder
+ *
+ * @param[out]  dec     Decoder state
+ * @param[in]   dit     Initial estimate of the dit duration, in the unit of
+ *                      the keying events
+ */
+void umorse_keydec_init(umorse_keydec_t *dec, uint32_t dit);
+
+/**
+ * @brief   Decodes a completed keying event
+ *
+ * @param[in,out]   dec     Decoder state
+ * @param[in]       key     Keying event, see umorse_key_t
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer, at least 2
+ *
+ * @returns     length of text written to output buffer
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_keydec_put(umorse_keydec_t *dec, umorse_key_t key,
+                      char *text, size_t tlen);
+
+/**
+ * @brief   Decodes an ongoing key up period
+ *
+ * Emits the current character, or a word gap, as soon as the key up period
+ * is long enough, instead of waiting for the next key down. Call this
+ * periodically while the key is up, the completed period is still passed
+ * to umorse_keydec_put afterwards.
+ *
+ * @param[in,out]   dec     Decoder state
+ * @param[in]       dur     Duration of key up so far
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer, at least 2
+ *
+ * @returns     length of text written to output buffer
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_keydec_idle(umorse_keydec_t *dec, uint32_t dur,
+                       char *text, size_t tlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_KEYDEC_H */
+/** @} */
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       One time init of uMorse lookup tables
+ *
+ * Tables built on first use are guarded by UMORSE_ONCE, such that threads
+ * calling in concurrently never see one half built. Build with
+ * UMORSE_THREADS set to 0 on targets without pthreads, then a plain flag
+ * is used and the first call must not race with others.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+
+#ifndef UMORSE_ONCE_H
+#define UMORSE_ONCE_H
+
+#ifndef UMORSE_THREADS
+#define UMORSE_THREADS          (1)
+#endif
+
+#if UMORSE_THREADS
+#include <pthread.h>
+
+typedef pthread_once_t umorse_once_t;
+#define UMORSE_ONCE_INIT        PTHREAD_ONCE_INIT
+#define UMORSE_ONCE(once, fn)   pthread_once((once), (fn))
+#else
+typedef int umorse_once_t;
+#define UMORSE_ONCE_INIT        (0)
+#define UMORSE_ONCE(once, fn)   do { if (!*(once)) { (fn)(); *(once) = 1; } } while (0)
+#endif
+
+#endif /* UMORSE_ONCE_H */
+/** @} */
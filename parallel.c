@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of multi-threaded uMorse encoder
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "umorse.h"
+
+typedef struct {
+    const char *text;   /**< input chunk */
+    size_t tlen;        /**< length of input chunk */
+    uint8_t *code;      /**< output of the byte the chunk starts in */
+    uint64_t bits;      /**< bits of the encoded chunk */
+    uint64_t offset;    /**< bit offset of the chunk in the output */
+    size_t written;     /**< whole bytes written by the chunk */
+    umorse_encoder_t enc;
+} _chunk_t;
+
+static void *_count(void *arg)
+{
+    _chunk_t *chunk = arg;
+
+    chunk->bits = umorse_encode_bits(chunk->text, chunk->tlen, chunk->enc.flags);
+    return NULL;
+}
+
+static void *_encode(void *arg)
+{
+    _chunk_t *chunk = arg;
+    /* bits of a preceding chunk in the first byte are left as 0 */
+    unsigned head = (unsigned)(chunk->offset % 8);
+
+    chunk->enc.acc = 0;
+    chunk->enc.bits = (uint8_t)head;
+    /* whole bytes only, the last partial byte stays in enc */
+    chunk->written = umorse_encoder_feed(&chunk->enc, chunk->text, chunk->tlen,
+                                         NULL, chunk->code,
+                                         (size_t)((head + chunk->bits) / 8));
+    return NULL;
+}
+
+/* run fn on all chunks, the calling thread takes the first one */
+static void _run(void *(*fn)(void *), _chunk_t *chunks, unsigned cnt)
+{
+    pthread_t tids[UMORSE_PARALLEL_THREADS_MAX];
+    int started[UMORSE_PARALLEL_THREADS_MAX];
+
+    for (unsigned i = 1; i < cnt; ++i) {
+        started[i] = (pthread_create(&tids[i], NULL, fn, &chunks[i]) == 0);
+        if (!started[i]) {
+            fn(&chunks[i]);
+        }
+    }
+    fn(&chunks[0]);
+    for (unsigned i = 1; i < cnt; ++i) {
+        if (started[i]) {
+            pthread_join(tids[i], NULL);
+        }
+    }
+}
+
+static unsigned _threads(unsigned threads, size_t tlen)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (unsigned)cpus : 1;
+    }
+    if (threads > UMORSE_PARALLEL_THREADS_MAX) {
+        threads = UMORSE_PARALLEL_THREADS_MAX;
+    }
+    if (threads > tlen / UMORSE_PARALLEL_CHUNK_MIN) {
+        threads = (unsigned)(tlen / UMORSE_PARALLEL_CHUNK_MIN);
+    }
+    return (threads > 0) ? threads : 1;
+}
+
+int umorse_encode_parallel(const char *text, size_t tlen,
+                           uint8_t *code, size_t clen, size_t *cused,
+                           uint8_t flags, unsigned threads)
+{
+    _chunk_t chunks[UMORSE_PARALLEL_THREADS_MAX];
+    unsigned cnt = _threads(threads, tlen);
+    uint64_t offset = 0;
+    size_t tpos = 0;
+
+    if (flags & UMORSE_CODE_DENSE) {
+        /* base 3 symbols do not split at bit offsets */
+        return -1;
+    }
+
+    for (unsigned i = 0; i < cnt; ++i) {
+        chunks[i].text = text + tpos;
+        chunks[i].tlen = (tlen - tpos) / (cnt - i);
+        umorse_encoder_init(&chunks[i].enc, flags);
+        tpos += chunks[i].tlen;
+    }
+    _run(_count, chunks, cnt);
+    for (unsigned i = 0; i < cnt; ++i) {
+        chunks[i].offset = offset;
+        chunks[i].code = code + offset / 8;
+        offset += chunks[i].bits;
+    }
+    /* room for the last partial byte and the final stop */
+    if ((offset / 8) + UMORSE_THRESHOLD > clen) {
+        return -1;
+    }
+    _run(_encode, chunks, cnt);
+
+    /* merge partial bytes at chunk boundaries, in order */
+    uint8_t carry = 0;
+    for (unsigned i = 0; i < cnt; ++i) {
+        if (chunks[i].written > 0) {
+            chunks[i].code[0] |= carry;
+            carry = 0;
+        }
+        carry |= (uint8_t)chunks[i].enc.acc;
+    }
+    umorse_encoder_t enc;
+    umorse_encoder_init(&enc, flags);
+    enc.acc = carry;
+    enc.bits = (uint8_t)(offset % 8);
+    size_t cpos = (size_t)(offset / 8);
+    int ret = umorse_encoder_finish(&enc, code + cpos, clen - cpos);
+    if (ret < 0) {
+        return ret;
+    }
+    *cused = cpos + ret;
+    return 0;
+}
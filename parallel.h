@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a multi-threaded uMorse encoder for large inputs
+ *
+ * The input is split into one chunk per thread. A first pass counts the bits
+ * of every chunk, their prefix sums give the exact output offset of each
+ * chunk, and a second pass has every thread encode its chunk straight into
+ * the shared output. In compact mode a chunk may start within a byte; no two
+ * threads write the same byte, the bits of shared bytes are merged after
+ * all threads are done. The output is identical to umorse_encode.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_PARALLEL_H
+#define UMORSE_PARALLEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   Minimum input length per thread, smaller inputs use less threads
+ */
+#ifndef UMORSE_PARALLEL_CHUNK_MIN
+#define UMORSE_PARALLEL_CHUNK_MIN   (1UL << 16)
+#endif
+
+/**
+ * @brief   Maximum number of threads
+ */
+#ifndef UMORSE_PARALLEL_THREADS_MAX
+#define UMORSE_PARALLEL_THREADS_MAX (64U)
+#endif
+
+/**
+ * @brief   Encodes a given sting into morse code using multiple threads
+ *
+ * Unlike umorse_encode the input is not truncated. Like umorse_encode, the
+ * output buffer must keep UMORSE_THRESHOLD bytes for the final stop, i.e.
+ * hold umorse_encode_bits / 8 + UMORSE_THRESHOLD bytes, which is at most one
+ * more than umorse_encode_len.
+ *
+ * @param[in]   text    Input text string
+ * @param[in]   tlen    Length of input string
+ * @param[out]  code    Output buffer for encoded text
+ * @param[in]   clen    Length of output buffer
+ * @param[out]  cused   Length of bytes written to output buffer
+ * @param[in]   flags   Optional flags, see umorse_encode
+ * @param[in]   threads Number of threads, 0 for one per online CPU
+ *
+ * @returns     0 on success
+ * @returns     < 0 if the output buffer is too small, or in dense mode
+ */
+int umorse_encode_parallel(const char *text, size_t tlen,
+                           uint8_t *code, size_t clen, size_t *cused,
+                           uint8_t flags, unsigned threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_PARALLEL_H */
+/** @} */
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of uMorse output interface synthesizing PCM audio
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef UMORSE_MSLEEP
+#include <unistd.h>
+#define UMORSE_MSLEEP(m)        usleep(m * 1000U)
+#endif
+
+#include "pcm.h"
+#include "umorse.h"
+
+#ifndef M_PI
+#define M_PI                    (3.14159265358979323846)
+#endif
+
+size_t umorse_pcm_buflen(uint32_t rate, unsigned dit_ms)
+{
+    /* dit, dah and silence */
+    return 5 * (((size_t)rate * dit_ms) / 1000U);
+}
+
+static void _synth(int16_t *buf, size_t len, size_t ramp,
+                   uint32_t rate, unsigned freq)
+{
+    double w = 2.0 * M_PI * freq / rate;
+
+    for (size_t i = 0; i < len; ++i) {
+        double env = 1.0;
+        if (i < ramp) {
+            env = 0.5 - 0.5 * cos(M_PI * i / ramp);
+        }
+        else if (i >= (len - ramp)) {
+            env = 0.5 - 0.5 * cos(M_PI * (len - 1 - i) / ramp);
+        }
+        buf[i] = (int16_t)lrint(UMORSE_PCM_AMPLITUDE * env * sin(w * i));
+    }
+}
+
+int umorse_pcm_init(umorse_pcm_t *pcm, int16_t *buf, size_t buflen,
+                    uint32_t rate, unsigned freq, unsigned dit_ms,
+                    umorse_pcm_write_t write, void *arg)
+{
+    size_t dit_len = ((size_t)rate * dit_ms) / 1000U;
+    size_t ramp = ((size_t)rate * UMORSE_PCM_RAMP_MS) / 1000U;
+
+    if ((dit_len == 0) || (buflen < umorse_pcm_buflen(rate, dit_ms))) {
+        return -1;
+    }
+    if (ramp > dit_len / 2) {
+        ramp = dit_len / 2;
+    }
+    _synth(buf, dit_len, ramp, rate, freq);
+    _synth(buf + dit_len, 3 * dit_len, ramp, rate, freq);
+    memset(buf + 4 * dit_len, 0, dit_len * sizeof(int16_t));
+
+    pcm->write = write;
+    pcm->arg = arg;
+    pcm->dit = buf;
+    pcm->dah = buf + dit_len;
+    pcm->nil = buf + 4 * dit_len;
+    pcm->dit_len = dit_len;
+    pcm->dit_ms = dit_ms;
+    return 0;
+}
+
+static inline void _put_le(uint8_t *p, uint32_t v, unsigned bytes)
+{
+    for (unsigned i = 0; i < bytes; ++i) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+void umorse_pcm_wav_header(uint8_t *hdr, uint32_t rate, uint32_t samples)
+{
+    uint32_t data = samples * sizeof(int16_t);
+
+    memcpy(hdr, "RIFF", 4);
+    _put_le(hdr + 4, 36 + data, 4);
+    memcpy(hdr + 8, "WAVEfmt ", 8);
+    _put_le(hdr + 16, 16, 4);               /* fmt chunk size */
+    _put_le(hdr + 20, 1, 2);                /* PCM */
+    _put_le(hdr + 22, 1, 2);                /* mono */
+    _put_le(hdr + 24, rate, 4);
+    _put_le(hdr + 28, rate * sizeof(int16_t), 4);
+    _put_le(hdr + 32, sizeof(int16_t), 2);  /* block align */
+    _put_le(hdr + 34, 16, 2);               /* bits per sample */
+    memcpy(hdr + 36, "data", 4);
+    _put_le(hdr + 40, data, 4);
+}
+
+void umorse_pcm_dit(void *args, uint8_t flags)
+{
+    umorse_pcm_t *pcm = args;
+
+    pcm->write(pcm->arg, pcm->dit, pcm->dit_len);
+    if (!(flags & UMORSE_FLAG_NODELAY)) {
+        UMORSE_MSLEEP(pcm->dit_ms);
+    }
+}
+
+void umorse_pcm_dah(void *args, uint8_t flags)
+{
+    umorse_pcm_t *pcm = args;
+
+    pcm->write(pcm->arg, pcm->dah, 3 * pcm->dit_len);
+    if (!(flags & UMORSE_FLAG_NODELAY)) {
+        UMORSE_MSLEEP(3 * pcm->dit_ms);
+    }
+}
+
+void umorse_pcm_nil(void *args, uint8_t flags)
+{
+    umorse_pcm_t *pcm = args;
+
+    uint8_t cnt = flags & UMORSE_MASK_COUNT;
+    while (cnt--) {
+        pcm->write(pcm->arg, pcm->nil, pcm->dit_len);
+        if (!(flags & UMORSE_FLAG_NODELAY)) {
+            UMORSE_MSLEEP(pcm->dit_ms);
+        }
+    }
+}
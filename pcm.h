@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse output interface synthesizing PCM audio
+ *
+ * Renders Morse code as 16 bit mono PCM samples. Dit, dah and silence are
+ * synthesized once on init, shaped with raised cosine ramps to avoid clicks,
+ * and afterwards only copied block wise to a user defined writer.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_PCM_H
+#define UMORSE_PCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name PCM synthesis parameters
+ * @{
+ */
+#ifndef UMORSE_PCM_RAMP_MS
+#define UMORSE_PCM_RAMP_MS          (5U)        /**< rise and fall time */
+#endif
+#ifndef UMORSE_PCM_AMPLITUDE
+#define UMORSE_PCM_AMPLITUDE        (26000)     /**< peak sample value */
+#endif
+#define UMORSE_PCM_WAV_HEADER_LEN   (44U)
+/** @} */
+
+/**
+ * @brief   Function pointer to write a block of samples
+ */
+typedef void(*umorse_pcm_write_t)(void *arg, const int16_t *samples, size_t len);
+
+/**
+ * @brief   PCM output state, use as params of a umorse_out_t
+ */
+typedef struct {
+    umorse_pcm_write_t write;   /**< writer for rendered samples */
+    void *arg;                  /**< argument passed to writer */
+    const int16_t *dit;         /**< dit samples */
+    const int16_t *dah;         /**< dah samples */
+    const int16_t *nil;         /**< one dit of silence */
+    size_t dit_len;             /**< samples per dit */
+    unsigned dit_ms;            /**< duration of a dit in milli seconds */
+} umorse_pcm_t;
+
+/**
+ * @brief   Returns required buffer length for umorse_pcm_init, in samples
+ *
+ * @param[in]   rate    Sample rate in Hz
+ * @param[in]   dit_ms  Duration of a dit in milli seconds
+ *
+ * @returns     number of samples
+ */
+size_t umorse_pcm_buflen(uint32_t rate, unsigned dit_ms);
+
+/**
+ * @brief   Synthesizes dit, dah and silence blocks into a given buffer
+ *
+ * @param[out]  pcm     PCM output state
+ * @param[out]  buf     Buffer for synthesized blocks
+ * @param[in]   buflen  Length of buffer, see umorse_pcm_buflen
+ * @param[in]   rate    Sample rate in Hz
+ * @param[in]   freq    Tone frequency in Hz
+ * @param[in]   dit_ms  Duration of a dit in milli seconds
+ * @param[in]   write   Writer for rendered samples
+ * @param[in]   arg     Argument passed to writer
+ *
+ * @returns     0 on success
+ * @returns     < 0 if the buffer is too small
+ */
+int umorse_pcm_init(umorse_pcm_t *pcm, int16_t *buf, size_t buflen,
+                    uint32_t rate, unsigned freq, unsigned dit_ms,
+                    umorse_pcm_write_t write, void *arg);
+
+/**
+ * @brief   Fills a WAV header for 16 bit mono PCM
+ *
+ * @param[out]  hdr     Header buffer of UMORSE_PCM_WAV_HEADER_LEN bytes
+ * @param[in]   rate    Sample rate in Hz
+ * @param[in]   samples Number of samples following the header
+ */
+void umorse_pcm_wav_header(uint8_t *hdr, uint32_t rate, uint32_t samples);
+
+/**
+ * @brief   Render Morse Code DIT (short)
+ *
+ * @param[in]   args    PCM output state, umorse_pcm_t
+ * @param[in]   flags   Control flags
+ */
+void umorse_pcm_dit(void *args, uint8_t flags);
+
+/**
+ * @brief   Render Morse Code DAH (long)
+ *
+ * @param[in]   args    PCM output state, umorse_pcm_t
+ * @param[in]   flags   Control flags
+ */
+void umorse_pcm_dah(void *args, uint8_t flags);
+
+/**
+ * @brief   Render Morse Code NIL (silent)
+ *
+ * @param[in]   args    PCM output state, umorse_pcm_t
+ * @param[in]   flags   Control flags
+ */
+void umorse_pcm_nil(void *args, uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_PCM_H */
+/** @} */
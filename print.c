@@ -77,3 +77,48 @@ void umorse_print_nil(void *args, uint8_t flags)
         }
     }
 }
+
+void umorse_print_batch(void *args, const uint8_t *span, size_t len, uint8_t flags)
+{
+    if (!(flags & UMORSE_FLAG_NODELAY)) {
+        /* keep timing of each element */
+        for (size_t i = 0; i < len; ++i) {
+            if (span[i] == UMORSE_DIT) {
+                umorse_print_dit(args, flags);
+            }
+            else if (span[i] == UMORSE_DAH) {
+                umorse_print_dah(args, flags);
+            }
+            else {
+                umorse_print_nil(args, (span[i] & UMORSE_MASK_COUNT) | flags);
+            }
+        }
+        return;
+    }
+
+    /* one print per span, at most 3 chars per entry */
+    char buf[3 * UMORSE_SPAN_LEN + 1];
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t cnt = span[i] & UMORSE_MASK_COUNT;
+        if (span[i] == UMORSE_DIT) {
+            buf[n++] = '.';
+        }
+        else if (span[i] == UMORSE_DAH) {
+            buf[n++] = '_';
+        }
+        else if (cnt > 7) {
+            buf[n++] = '\n';
+        }
+        else if (cnt > 3) {
+            buf[n++] = ' ';
+            buf[n++] = '/';
+            buf[n++] = ' ';
+        }
+        else if (cnt > 1) {
+            buf[n++] = ' ';
+        }
+    }
+    buf[n] = '\0';
+    UMORSE_PRINT("%s", buf);
+}
@@ -22,6 +22,7 @@
 #ifndef UMORSE_PRINT_H
 #define UMORSE_PRINT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -52,6 +53,18 @@ void umorse_print_dah(void *args, uint8_t flags);
  */
 void umorse_print_nil(void *args, uint8_t flags);
 
+/**
+ * @brief   Print a span of Morse Code elements
+ *
+ * @note    With UMORSE_FLAG_NODELAY set the whole span is printed at once.
+ *
+ * @param[in]   args    unused
+ * @param[in]   span    Elements to print, see umorse_batch_fp_t
+ * @param[in]   len     Number of elements in span
+ * @param[in]   flags   Control flags
+ */
+void umorse_print_batch(void *args, const uint8_t *span, size_t len, uint8_t flags);
+
 #ifdef __cplusplus
 }
 #endif
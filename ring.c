@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a lock-free ring between encoder and output
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "emit.h"
+#include "ring.h"
+#include "stats.h"
+#include "umorse.h"
+
+/* bounce buffer for chars that do not fit before the end of the ring */
+#define UMORSE_RING_BOUNCE_LEN  (8U)
+
+static void _signal(umorse_ring_event_t *ev)
+{
+    __atomic_fetch_add(&ev->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ev->waiting, __ATOMIC_SEQ_CST)) {
+#ifdef __linux__
+        syscall(SYS_futex, &ev->seq, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+/**
+ * @brief   Sleeps until the other end moved @p pos away from @p old, or
+ *          @p closed is set
+ *
+ * The event count is read before the condition, so a signal in between
+ * makes the futex return at once instead of getting lost.
+ */
+static void _wait(umorse_ring_event_t *ev, const size_t *pos, size_t old,
+                  const uint32_t *closed)
+{
+    uint32_t seq = __atomic_load_n(&ev->seq, __ATOMIC_SEQ_CST);
+
+    __atomic_store_n(&ev->waiting, 1, __ATOMIC_SEQ_CST);
+    if ((__atomic_load_n(pos, __ATOMIC_SEQ_CST) == old) &&
+        !(closed && __atomic_load_n(closed, __ATOMIC_SEQ_CST))) {
+#ifdef __linux__
+        syscall(SYS_futex, &ev->seq, FUTEX_WAIT_PRIVATE, seq, NULL, NULL, 0);
+#else
+        (void) seq;
+        usleep(UMORSE_RING_POLL_US);
+#endif
+    }
+    __atomic_store_n(&ev->waiting, 0, __ATOMIC_RELAXED);
+}
+
+int umorse_ring_init(umorse_ring_t *ring, uint8_t *buf, size_t size, uint8_t flags)
+{
+    if ((size < UMORSE_RING_SIZE_MIN) || (size & (size - 1)) ||
+        (flags & UMORSE_CODE_DENSE)) {
+        return -1;
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->buf = buf;
+    ring->size = size;
+    umorse_encoder_init(&ring->enc, flags);
+    return 0;
+}
+
+/* copies code to the head, wrapping at the end of the ring */
+static void _copy(umorse_ring_t *ring, size_t head, const uint8_t *code, size_t clen)
+{
+    size_t off = head & (ring->size - 1);
+    size_t n = (clen < ring->size - off) ? clen : ring->size - off;
+
+    memcpy(ring->buf + off, code, n);
+    memcpy(ring->buf, code + n, clen - n);
+}
+
+int umorse_ring_write(umorse_ring_t *ring, const char *text, size_t tlen, int wait)
+{
+    size_t tpos = 0;
+
+    while (tpos < tlen) {
+        uint8_t tmp[UMORSE_RING_BOUNCE_LEN];
+        size_t head = ring->head;
+        size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        size_t room = ring->size - (head - tail);
+        size_t off = head & (ring->size - 1);
+        size_t tused = 0;
+        int n;
+        if ((ring->size - off < room) && (ring->size - off < sizeof(tmp))) {
+            /* a char may span the end, encode aside and copy */
+            room = (room < sizeof(tmp)) ? room : sizeof(tmp);
+            n = umorse_encoder_feed(&ring->enc, text + tpos, tlen - tpos, &tused,
+                                    tmp, room);
+            _copy(ring, head, tmp, n);
+        }
+        else {
+            room = (room < ring->size - off) ? room : ring->size - off;
+            n = umorse_encoder_feed(&ring->enc, text + tpos, tlen - tpos, &tused,
+                                    ring->buf + off, room);
+        }
+        if (n > 0) {
+            __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+            _signal(&ring->data);
+        }
+        tpos += tused;
+        if ((n == 0) && (tused == 0)) {
+            if (!wait) {
+                break;
+            }
+            _wait(&ring->space, &ring->tail, tail, NULL);
+        }
+    }
+    return tpos;
+}
+
+int umorse_ring_close(umorse_ring_t *ring, int wait)
+{
+    uint8_t tmp[UMORSE_RING_BOUNCE_LEN];
+    size_t head = ring->head;
+    size_t tail;
+
+    while (ring->size - (head - (tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)))
+           < UMORSE_THRESHOLD) {
+        if (!wait) {
+            return -1;
+        }
+        _wait(&ring->space, &ring->tail, tail, NULL);
+    }
+    int n = umorse_encoder_finish(&ring->enc, tmp, UMORSE_THRESHOLD);
+    _copy(ring, head, tmp, n);
+    __atomic_store_n(&ring->head, head + n, __ATOMIC_RELEASE);
+    /* after the head, such that a closed ring has all code visible */
+    __atomic_store_n(&ring->closed, 1, __ATOMIC_RELEASE);
+    _signal(&ring->data);
+    return 0;
+}
+
+static void _output_byte(umorse_ring_t *ring, const umorse_out_t *out,
+                         uint8_t b, uint8_t flags)
+{
+    for (unsigned j = 0; j < 4; ++j) {
+        uint8_t cc = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+        if (cc == UMORSE_END_CHAR) {
+            ++ring->spaces;
+        }
+        else if (cc != UMORSE_NUL) {
+            if (ring->spaces > 0) {
+                umorse_emit(out, UMORSE_SPAN_NIL | umorse_spaces_count(ring->spaces), flags);
+                ring->spaces = 0;
+            }
+            umorse_emit(out, cc, flags);
+            umorse_emit(out, UMORSE_SPAN_NIL | 0x1, flags);
+        }
+    }
+}
+
+int umorse_ring_output(umorse_ring_t *ring, const umorse_out_t *out,
+                       uint8_t flags, int wait)
+{
+    for (;;) {
+        size_t tail = ring->tail;
+        /* closed before head, a closed ring has its final head visible */
+        uint32_t closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        if (head != tail) {
+            UMORSE_STATS_ADD(output_calls, 1);
+            for (size_t i = tail; i != head; ++i) {
+                _output_byte(ring, out, ring->buf[i & (ring->size - 1)], flags);
+                __atomic_store_n(&ring->tail, i + 1, __ATOMIC_RELEASE);
+                _signal(&ring->space);
+            }
+            return head - tail;
+        }
+        if (closed) {
+            if (!ring->done && (ring->spaces > 0)) {
+                umorse_emit(out, UMORSE_SPAN_NIL | umorse_spaces_count(ring->spaces), flags);
+            }
+            ring->done = 1;
+            return 0;
+        }
+        if (!wait) {
+            return 0;
+        }
+        _wait(&ring->data, &ring->head, tail, &ring->closed);
+    }
+}
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a lock-free ring between encoder and output
+ *
+ * A single producer thread encodes text into the ring, while a single
+ * consumer thread plays the code out through an output interface, such that
+ * a long message starts to play after its first characters are encoded.
+ * Both ends only publish their position with release stores, a full ring
+ * holds back the producer and an empty ring the consumer. Waiting ends
+ * sleep on a futex on Linux and poll elsewhere; the other end only makes a
+ * system call to wake them if one actually sleeps.
+ *
+ * Calls to the output interface and their order are the same as those of
+ * umorse_output for the code of the whole text. Aligned and compact code
+ * are supported.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_RING_H
+#define UMORSE_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "umorse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Ring parameters
+ * @{
+ */
+#ifndef UMORSE_RING_CACHELINE
+#define UMORSE_RING_CACHELINE   (64U)   /**< keeps both ends apart */
+#endif
+#define UMORSE_RING_SIZE_MIN    (4U)    /**< room for a char and a gap */
+#define UMORSE_RING_POLL_US     (1000U) /**< wait interval without futex */
+/** @} */
+
+/**
+ * @brief   Wakeup signal of one end, an event count
+ */
+typedef struct {
+    uint32_t seq;       /**< changed on every signal */
+    uint32_t waiting;   /**< set while the other end sleeps */
+} umorse_ring_event_t;
+
+/**
+ * @brief   Ring of encoded code bytes
+ */
+typedef struct {
+    uint8_t *buf;               /**< storage, size is a power of 2 */
+    size_t size;                /**< number of bytes in buf */
+    /** producer side */
+    size_t head __attribute__((aligned(UMORSE_RING_CACHELINE)));
+    umorse_encoder_t enc;       /**< encoder state */
+    uint32_t closed;            /**< set once the final stop is written */
+    umorse_ring_event_t data;   /**< signals new code or close */
+    /** consumer side */
+    size_t tail __attribute__((aligned(UMORSE_RING_CACHELINE)));
+    size_t spaces;              /**< inter char gaps since the last element */
+    uint8_t done;               /**< set once the final gap is output */
+    umorse_ring_event_t space;  /**< signals released code */
+} umorse_ring_t;
+
+/**
+ * @brief   Initializes an empty ring
+ *
+ * @param[out]  ring    Ring
+ * @param[in]   buf     Storage for code
+ * @param[in]   size    Length of @p buf, a power of 2, at least
+ *                      UMORSE_RING_SIZE_MIN
+ * @param[in]   flags   UMORSE_CODE_ALIGNED or UMORSE_CODE_COMPACT
+ *
+ * @returns     0 on success
+ * @returns     < 0 on an invalid size or dense mode
+ */
+int umorse_ring_init(umorse_ring_t *ring, uint8_t *buf, size_t size, uint8_t flags);
+
+/**
+ * @brief   Encodes text into the ring, producer side
+ *
+ * @param[in,out]   ring    Ring
+ * @param[in]       text    Text to encode
+ * @param[in]       tlen    Length of text
+ * @param[in]       wait    Wait for room until all text is encoded, else
+ *                          stop once the ring is full
+ *
+ * @returns     number of text bytes encoded
+ */
+int umorse_ring_write(umorse_ring_t *ring, const char *text, size_t tlen, int wait);
+
+/**
+ * @brief   Appends the final stop and closes the ring, producer side
+ *
+ * @param[in,out]   ring    Ring
+ * @param[in]       wait    Wait for room, else fail on a full ring
+ *
+ * @returns     0 on success
+ * @returns     < 0 if the ring is full and @p wait is 0
+ */
+int umorse_ring_close(umorse_ring_t *ring, int wait);
+
+/**
+ * @brief   Outputs the code available in the ring, consumer side
+ *
+ * Code is released to the producer byte by byte as it is output. A gap at
+ * the end of the available code is held back until the next element or the
+ * close, as its length may still grow.
+ *
+ * @param[in,out]   ring    Ring
+ * @param[in]       out     Output interface
+ * @param[in]       flags   Flags passed on to the output interface
+ * @param[in]       wait    Wait for code if the ring is empty
+ *
+ * @returns     number of code bytes output
+ * @returns     0 if the ring is empty, with @p wait only once it is closed
+ *              and all code is output
+ */
+int umorse_ring_output(umorse_ring_t *ring, const umorse_out_t *out,
+                       uint8_t flags, int wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_RING_H */
+/** @} */
@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a scheduler driving many uMorse outputs
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "emit.h"
+#include "sched.h"
+#include "stats.h"
+#include "umorse.h"
+
+/* outputs the next element, returns its duration in dits or 0 when done */
+static uint8_t _step(umorse_job_t *job)
+{
+    uint8_t cnt;
+
+    if (job->gap) {
+        job->gap = 0;
+        umorse_emit(job->out, UMORSE_SPAN_NIL | 0x1, job->flags);
+        return 1;
+    }
+    for (; job->pos < 4 * job->clen; ++job->pos) {
+        uint8_t cc = (job->code[job->pos / 4] >> ((job->pos % 4) * UMORSE_SHIFT))
+                     & UMORSE_MASK;
+        if (cc == UMORSE_END_CHAR) {
+            ++job->spaces;
+        }
+        else if (cc != UMORSE_NUL) {
+            if (job->spaces > 0) {
+                /* element follows with the next step */
+                break;
+            }
+            ++job->pos;
+            umorse_emit(job->out, cc, job->flags);
+            job->gap = 1;
+            return (cc == UMORSE_DAH) ? 3 : 1;
+        }
+    }
+    cnt = umorse_spaces_count(job->spaces);
+    job->spaces = 0;
+    if (cnt > 0) {
+        umorse_emit(job->out, UMORSE_SPAN_NIL | cnt, job->flags);
+    }
+    return cnt;
+}
+
+static inline void _swap(umorse_sched_t *sched, size_t a, size_t b)
+{
+    umorse_job_t *job = sched->heap[a];
+
+    sched->heap[a] = sched->heap[b];
+    sched->heap[b] = job;
+    sched->heap[a]->idx = (uint32_t)a;
+    sched->heap[b]->idx = (uint32_t)b;
+}
+
+static void _sift_up(umorse_sched_t *sched, size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (sched->heap[parent]->deadline <= sched->heap[i]->deadline) {
+            break;
+        }
+        _swap(sched, i, parent);
+        i = parent;
+    }
+}
+
+static void _sift_down(umorse_sched_t *sched, size_t i)
+{
+    for (;;) {
+        size_t min = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if ((left < sched->len) &&
+            (sched->heap[left]->deadline < sched->heap[min]->deadline)) {
+            min = left;
+        }
+        if ((right < sched->len) &&
+            (sched->heap[right]->deadline < sched->heap[min]->deadline)) {
+            min = right;
+        }
+        if (min == i) {
+            break;
+        }
+        _swap(sched, i, min);
+        i = min;
+    }
+}
+
+void umorse_job_init(umorse_job_t *job, const umorse_out_t *out,
+                     const uint8_t *code, size_t clen,
+                     uint32_t dit_us, uint8_t flags)
+{
+    job->out = out;
+    job->code = code;
+    job->clen = clen;
+    job->pos = 0;
+    job->spaces = 0;
+    job->deadline = 0;
+    job->dit = dit_us;
+    job->idx = 0;
+    job->done = NULL;
+    job->arg = NULL;
+    job->flags = flags | UMORSE_FLAG_NODELAY;
+    job->gap = 0;
+}
+
+void umorse_sched_init(umorse_sched_t *sched, umorse_job_t **heap, size_t size)
+{
+    sched->heap = heap;
+    sched->len = 0;
+    sched->size = size;
+    sched->now = 0;
+}
+
+int umorse_sched_add(umorse_sched_t *sched, umorse_job_t *job, uint64_t start)
+{
+    if ((sched->len >= sched->size) || (job->flags & UMORSE_FLAG_DENSE)) {
+        return -1;
+    }
+    UMORSE_STATS_ADD(output_calls, 1);
+    job->deadline = start;
+    job->idx = (uint32_t)sched->len;
+    sched->heap[sched->len++] = job;
+    _sift_up(sched, job->idx);
+    return 0;
+}
+
+void umorse_sched_remove(umorse_sched_t *sched, umorse_job_t *job)
+{
+    size_t i = job->idx;
+
+    if (--sched->len == i) {
+        return;
+    }
+    _swap(sched, i, sched->len);
+    /* the moved job may belong either above or below */
+    _sift_up(sched, i);
+    _sift_down(sched, i);
+}
+
+uint64_t umorse_sched_next(const umorse_sched_t *sched)
+{
+    return (sched->len > 0) ? sched->heap[0]->deadline : UMORSE_SCHED_IDLE;
+}
+
+size_t umorse_sched_run(umorse_sched_t *sched, uint64_t now)
+{
+    size_t cnt = 0;
+
+    while ((sched->len > 0) && (sched->heap[0]->deadline <= now)) {
+        umorse_job_t *job = sched->heap[0];
+        sched->now = job->deadline;
+        uint8_t dits = _step(job);
+        if (dits == 0) {
+            umorse_sched_remove(sched, job);
+            if (job->done) {
+                job->done(job, job->arg);
+            }
+            continue;
+        }
+        ++cnt;
+        job->deadline += (uint64_t)dits * job->dit;
+        _sift_down(sched, 0);
+    }
+    return cnt;
+}
+
+uint64_t umorse_sched_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+#ifdef __linux__
+int umorse_sched_loop(umorse_sched_t *sched)
+{
+    struct epoll_event ev = { .events = EPOLLIN };
+    int ret = -1;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    int efd = epoll_create1(EPOLL_CLOEXEC);
+
+    if ((tfd < 0) || (efd < 0) || (epoll_ctl(efd, EPOLL_CTL_ADD, tfd, &ev) < 0)) {
+        goto out;
+    }
+    uint64_t next;
+    while ((next = umorse_sched_next(sched)) != UMORSE_SCHED_IDLE) {
+        if (next > umorse_sched_clock()) {
+            struct itimerspec its = {
+                .it_value = {
+                    .tv_sec = (time_t)(next / 1000000ULL),
+                    .tv_nsec = (long)(next % 1000000ULL) * 1000L
+                }
+            };
+            uint64_t expired;
+            if (timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+                goto out;
+            }
+            int n = epoll_wait(efd, &ev, 1, -1);
+            if ((n < 0) && (errno != EINTR)) {
+                goto out;
+            }
+            if ((n > 0) && (read(tfd, &expired, sizeof(expired)) < 0)) {
+                goto out;
+            }
+        }
+        umorse_sched_run(sched, umorse_sched_clock());
+    }
+    ret = 0;
+out:
+    if (efd >= 0) {
+        close(efd);
+    }
+    if (tfd >= 0) {
+        close(tfd);
+    }
+    return ret;
+}
+#else
+int umorse_sched_loop(umorse_sched_t *sched)
+{
+    (void) sched;
+    return -1;
+}
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a scheduler driving many uMorse outputs
+ *
+ * Instead of blocking one thread per output in sleeps, a scheduler owns any
+ * number of jobs, each an output interface with a code buffer. Jobs are kept
+ * in a min-heap ordered by the deadline of their next element; at its
+ * deadline a job makes exactly one call to dit, dah, nil or batch, always
+ * with UMORSE_FLAG_NODELAY, and is put back with the deadline after that
+ * element. Calls and their order are the same as those of umorse_output.
+ * Stepping a job costs O(log n) for n jobs.
+ *
+ * Time is given in micro seconds by the caller, so the scheduler can run on a
+ * virtual clock, or on the monotonic clock with umorse_sched_loop.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_SCHED_H
+#define UMORSE_SCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "umorse.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief   No deadline, returned if no job is scheduled
+ */
+#define UMORSE_SCHED_IDLE       (UINT64_MAX)
+
+typedef struct umorse_job umorse_job_t;
+
+/**
+ * @brief   Function pointer called when a job has output all its code
+ *
+ * The job is already removed from the scheduler and may be added again.
+ */
+typedef void(*umorse_job_done_t)(umorse_job_t *job, void *arg);
+
+/**
+ * @brief   Output job, state of one umorse_output in progress
+ */
+struct umorse_job {
+    const umorse_out_t *out;    /**< output interface */
+    const uint8_t *code;        /**< morse encoded text */
+    size_t clen;                /**< length of morse encoded text */
+    size_t pos;                 /**< next element, in pairs of bits */
+    size_t spaces;              /**< inter char gaps seen before next element */
+    uint64_t deadline;          /**< time of next element, in us */
+    uint32_t dit;               /**< duration of a dit, in us */
+    uint32_t idx;               /**< position in scheduler heap */
+    umorse_job_done_t done;     /**< called on completion, may be NULL */
+    void *arg;                  /**< argument passed to done */
+    uint8_t flags;              /**< flags passed to output */
+    uint8_t gap;                /**< element gap pending */
+};
+
+/**
+ * @brief   Scheduler state
+ */
+typedef struct {
+    umorse_job_t **heap;        /**< jobs, ordered by deadline */
+    size_t len;                 /**< number of scheduled jobs */
+    size_t size;                /**< capacity of heap */
+    uint64_t now;               /**< deadline of the element being output */
+} umorse_sched_t;
+
+/**
+ * @brief   Initializes a job
+ *
+ * @param[out]  job     Output job
+ * @param[in]   out     Interface or device to output morse encoded buffer
+ * @param[in]   code    Buffer with morse encoded text, kept until done
+ * @param[in]   clen    Length of morse encoded text
+ * @param[in]   dit_us  Duration of a dit in micro seconds
+ * @param[in]   flags   Flags passed to output, UMORSE_FLAG_NODELAY is added;
+ *                      dense code is not supported, see umorse_sched_add
+ */
+void umorse_job_init(umorse_job_t *job, const umorse_out_t *out,
+                     const uint8_t *code, size_t clen,
+                     uint32_t dit_us, uint8_t flags);
+
+/**
+ * @brief   Initializes a scheduler with storage for a given number of jobs
+ *
+ * @param[out]  sched   Scheduler state
+ * @param[in]   heap    Storage for size job pointers
+ * @param[in]   size    Maximum number of jobs
+ */
+void umorse_sched_init(umorse_sched_t *sched, umorse_job_t **heap, size_t size);
+
+/**
+ * @brief   Adds a job, which starts output at a given time
+ *
+ * @param[in,out]   sched   Scheduler state
+ * @param[in,out]   job     Initialized job, not yet scheduled
+ * @param[in]       start   Time of the first element, in us
+ *
+ * @returns     0 on success
+ * @returns     < 0 if the scheduler is full, or the job has UMORSE_FLAG_DENSE
+ *              set, as jobs step through code by pairs of bits
+ */
+int umorse_sched_add(umorse_sched_t *sched, umorse_job_t *job, uint64_t start);
+
+/**
+ * @brief   Removes a scheduled job, done is not called
+ *
+ * @param[in,out]   sched   Scheduler state
+ * @param[in,out]   job     Scheduled job
+ */
+void umorse_sched_remove(umorse_sched_t *sched, umorse_job_t *job);
+
+/**
+ * @brief   Returns the earliest deadline of all jobs
+ *
+ * @param[in]   sched   Scheduler state
+ *
+ * @returns     time in us, or UMORSE_SCHED_IDLE if no job is scheduled
+ */
+uint64_t umorse_sched_next(const umorse_sched_t *sched);
+
+/**
+ * @brief   Outputs all elements due up to a given time
+ *
+ * Jobs falling behind catch up element by element, in order of deadlines.
+ * Deadlines follow from the previous deadline, not from @p now, such that
+ * late calls do not add up to drift. While an element is output,
+ * sched->now holds its deadline.
+ *
+ * @param[in,out]   sched   Scheduler state
+ * @param[in]       now     Current time in us
+ *
+ * @returns     number of elements output
+ */
+size_t umorse_sched_run(umorse_sched_t *sched, uint64_t now);
+
+/**
+ * @brief   Runs all jobs to completion on the monotonic clock
+ *
+ * Sleeps on a single timerfd via epoll until the next deadline. Only
+ * available on Linux.
+ *
+ * @param[in,out]   sched   Scheduler state, deadlines on CLOCK_MONOTONIC
+ *
+ * @returns     0 when all jobs are done
+ * @returns     < 0 on error
+ */
+int umorse_sched_loop(umorse_sched_t *sched);
+
+/**
+ * @brief   Returns the current time of the monotonic clock in us
+ */
+uint64_t umorse_sched_clock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_SCHED_H */
+/** @} */
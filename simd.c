@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of vectorized uMorse encoder for x86
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "once.h"
+#include "simd.h"
+#include "stats.h"
+#include "symbols.h"
+#include "umorse.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define UMORSE_SIMD_X86         (1)
+#include <immintrin.h>
+#else
+#define UMORSE_SIMD_X86         (0)
+#endif
+
+/* max output of a 16 byte block, 3 bytes per char plus a full store */
+#define UMORSE_SIMD_BLOCK_MAX   (3 * 16 + 4)
+
+static unsigned umorse_simd_max = UMORSE_SIMD_AVX2;
+
+#if UMORSE_SIMD_X86
+
+/**
+ * @brief   Lookup tables for the vector encoder
+ *
+ * Code words are taken from the scalar encoder on init, such that both
+ * always agree. Numbers and punctuation from ' ' to '?' share one table
+ * of the two code bytes, where 0 marks chars without a code word; '@' and
+ * '_' are the only symbols outside. A group of 4 chars is expanded to 4
+ * bytes each, of which the first 0 to 3 are valid; the masks squeeze out
+ * the invalid ones.
+ */
+static uint8_t umorse_simd_letters[32];     /**< code of 'A' to 'Z' */
+static uint8_t umorse_simd_symbols[2][32];  /**< code of ' ' to '?', b0/b1 */
+static uint8_t umorse_simd_at[2];           /**< code of '@' */
+static uint8_t umorse_simd_under[2];        /**< code of '_' */
+static uint8_t umorse_simd_masks[256][16];  /**< compaction by lengths */
+static uint8_t umorse_simd_lens[256];       /**< output length by lengths */
+
+/* letters take one code byte, any other symbol two in the tables above */
+#define UMORSE_SIMD_CHECK(c, cw)                                        \
+    _Static_assert((((c) >= 'A') && ((c) <= 'Z')) ? ((cw) <= 0xFF) :    \
+                   ((cw) > 0xFF) && ((((c) > ' ') && ((c) <= '?')) ||   \
+                                     ((c) == '@') || ((c) == '_')),     \
+                   "symbol does not fit the vector encoder tables");
+UMORSE_SYMBOLS(UMORSE_SIMD_CHECK)
+#undef UMORSE_SIMD_CHECK
+
+static void _build_tables(void)
+{
+    uint8_t code[8];
+
+    for (unsigned i = 0; i < 26; ++i) {
+        char c = (char)('A' + i);
+        umorse_encode_aligned(&c, 1, code, sizeof(code));
+        umorse_simd_letters[i] = code[0];
+    }
+    /* space is handled apart, as it takes a single byte */
+    for (unsigned i = 1; i < 32; ++i) {
+        char c = (char)(' ' + i);
+        if (umorse_encode_aligned(&c, 1, code, sizeof(code)) > 1) {
+            umorse_simd_symbols[0][i] = code[0];
+            umorse_simd_symbols[1][i] = code[1];
+        }
+    }
+    umorse_encode_aligned("@", 1, code, sizeof(code));
+    umorse_simd_at[0] = code[0];
+    umorse_simd_at[1] = code[1];
+    umorse_encode_aligned("_", 1, code, sizeof(code));
+    umorse_simd_under[0] = code[0];
+    umorse_simd_under[1] = code[1];
+    for (unsigned key = 0; key < 256; ++key) {
+        unsigned n = 0;
+        for (unsigned i = 0; i < 4; ++i) {
+            unsigned len = (key >> (2 * i)) & 0x3;
+            for (unsigned j = 0; j < len; ++j) {
+                umorse_simd_masks[key][n++] = (uint8_t)(4 * i + j);
+            }
+        }
+        umorse_simd_lens[key] = (uint8_t)n;
+        while (n < 16) {
+            umorse_simd_masks[key][n++] = 0x80;
+        }
+    }
+}
+
+static void _init_tables(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_tables);
+}
+
+/**
+ * @brief   Defines fn to classify a vector of chars, for any vector width
+ *
+ * Returns code bytes b0, b1, b2 and the lengths of the chars in x. P and W
+ * are the intrinsic prefix and integer suffix of the vector type V, load
+ * reads 16 bytes of a table into each 128 bit lane.
+ */
+#define UMORSE_SIMD_CLASSIFY(fn, isa, V, P, W, load)                          \
+__attribute__((target(isa)))                                                  \
+static inline void fn(V x, V *b0, V *b1, V *b2, V *len)                       \
+{                                                                             \
+    const V letters_lo = load(umorse_simd_letters);                           \
+    const V letters_hi = load(umorse_simd_letters + 16);                      \
+    const V symbols0_lo = load(umorse_simd_symbols[0]);                       \
+    const V symbols0_hi = load(umorse_simd_symbols[0] + 16);                  \
+    const V symbols1_lo = load(umorse_simd_symbols[1]);                       \
+    const V symbols1_hi = load(umorse_simd_symbols[1] + 16);                  \
+    const V gap = P##_set1_epi8(UMORSE_END_CHAR);                             \
+                                                                              \
+    /* case folding, letters become 0 to 25 */                                \
+    V l = P##_sub_epi8(P##_or_##W(x, P##_set1_epi8(0x20)), P##_set1_epi8('a')); \
+    V is_letter = P##_cmpeq_epi8(P##_min_epu8(l, P##_set1_epi8(25)), l);      \
+    /* numbers and punctuation become 0 to 31 */                              \
+    V p = P##_sub_epi8(x, P##_set1_epi8(' '));                                \
+    V in_symbols = P##_cmpeq_epi8(P##_min_epu8(p, P##_set1_epi8(31)), p);     \
+    V is_at = P##_cmpeq_epi8(x, P##_set1_epi8('@'));                          \
+    V is_under = P##_cmpeq_epi8(x, P##_set1_epi8('_'));                       \
+    V is_space = P##_or_##W(P##_cmpeq_epi8(x, P##_set1_epi8(' ')),            \
+                            P##_cmpeq_epi8(x, P##_set1_epi8('\t')));          \
+    /* control chars 1 to 31, except tab */                                   \
+    V s = P##_sub_epi8(x, P##_set1_epi8(1));                                  \
+    V is_stop = P##_andnot_##W(is_space,                                      \
+        P##_cmpeq_epi8(P##_min_epu8(s, P##_set1_epi8(30)), s));               \
+                                                                              \
+    /* pshufb yields 0 for indexes with bit 7 set */                          \
+    V hi = P##_cmpgt_epi8(l, P##_set1_epi8(15));                              \
+    V lc = P##_or_##W(P##_shuffle_epi8(letters_lo, P##_or_##W(l, hi)),        \
+                      P##_shuffle_epi8(letters_hi,                            \
+                          P##_or_##W(P##_sub_epi8(l, P##_set1_epi8(16)),      \
+                                     P##_andnot_##W(hi, P##_set1_epi8(-128))))); \
+    V phi = P##_cmpgt_epi8(p, P##_set1_epi8(15));                             \
+    V plo = P##_or_##W(p, phi);                                               \
+    V phx = P##_or_##W(P##_sub_epi8(p, P##_set1_epi8(16)),                    \
+                       P##_andnot_##W(phi, P##_set1_epi8(-128)));             \
+    V sc0 = P##_or_##W(P##_shuffle_epi8(symbols0_lo, plo),                    \
+                       P##_shuffle_epi8(symbols0_hi, phx));                   \
+    V sc1 = P##_or_##W(P##_shuffle_epi8(symbols1_lo, plo),                    \
+                       P##_shuffle_epi8(symbols1_hi, phx));                   \
+    V is_symbol = P##_andnot_##W(P##_cmpeq_epi8(sc0, P##_setzero_##W()),      \
+                                 in_symbols);                                 \
+    V is_long = P##_or_##W(is_symbol, P##_or_##W(is_at, is_under));           \
+                                                                              \
+    *b0 = P##_or_##W(P##_or_##W(P##_and_##W(is_letter, lc),                   \
+                                P##_and_##W(is_symbol, sc0)),                 \
+                     P##_or_##W(P##_and_##W(is_space, P##_set1_epi8(UMORSE_END_WORD)), \
+                                P##_and_##W(is_stop, P##_set1_epi8((char)UMORSE_END_STOP)))); \
+    *b0 = P##_or_##W(*b0, P##_or_##W(                                         \
+        P##_and_##W(is_at, P##_set1_epi8((char)umorse_simd_at[0])),           \
+        P##_and_##W(is_under, P##_set1_epi8((char)umorse_simd_under[0]))));   \
+    *b1 = P##_or_##W(P##_or_##W(P##_and_##W(is_letter, gap),                  \
+                                P##_and_##W(is_symbol, sc1)),                 \
+                     P##_or_##W(                                              \
+                         P##_and_##W(is_at, P##_set1_epi8((char)umorse_simd_at[1])), \
+                         P##_and_##W(is_under, P##_set1_epi8((char)umorse_simd_under[1])))); \
+    *b2 = P##_and_##W(is_long, gap);                                          \
+    /* letters 2, numbers and symbols 3, spaces and stops 1 */                \
+    *len = P##_sub_epi8(P##_setzero_##W(),                                    \
+                        P##_add_epi8(P##_add_epi8(is_letter, is_letter),      \
+                                     P##_add_epi8(P##_add_epi8(is_long, is_long), \
+                                                  P##_or_##W(is_long,         \
+                                                             P##_or_##W(is_space, is_stop))))); \
+}
+
+__attribute__((target("ssse3")))
+static inline __m128i _load_sse(const uint8_t *table)
+{
+    return _mm_loadu_si128((const __m128i *)table);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i _load_avx2(const uint8_t *table)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+UMORSE_SIMD_CLASSIFY(_classify_sse, "ssse3", __m128i, _mm, si128, _load_sse)
+UMORSE_SIMD_CLASSIFY(_classify_avx2, "avx2", __m256i, _mm256, si256, _load_avx2)
+
+/* compact and store 16 classified chars, returns new output position */
+__attribute__((target("ssse3")))
+static inline size_t _store_sse(__m128i b0, __m128i b1, __m128i b2, __m128i len,
+                                uint8_t *code, size_t cpos)
+{
+    uint32_t keys[4];
+    __m128i z = _mm_setzero_si128();
+    __m128i p01lo = _mm_unpacklo_epi8(b0, b1);
+    __m128i p01hi = _mm_unpackhi_epi8(b0, b1);
+    __m128i p2lo = _mm_unpacklo_epi8(b2, z);
+    __m128i p2hi = _mm_unpackhi_epi8(b2, z);
+    __m128i g[4] = {
+        _mm_unpacklo_epi16(p01lo, p2lo), _mm_unpackhi_epi16(p01lo, p2lo),
+        _mm_unpacklo_epi16(p01hi, p2hi), _mm_unpackhi_epi16(p01hi, p2hi),
+    };
+    /* key of each group of 4 is l0 | l1 << 2 | l2 << 4 | l3 << 6 */
+    __m128i k = _mm_madd_epi16(_mm_maddubs_epi16(len, _mm_set1_epi16(0x0401)),
+                               _mm_set1_epi32(0x00100001));
+    _mm_storeu_si128((__m128i *)keys, k);
+
+    for (unsigned i = 0; i < 4; ++i) {
+        __m128i m = _mm_loadu_si128((const __m128i *)umorse_simd_masks[keys[i]]);
+        _mm_storeu_si128((__m128i *)(code + cpos), _mm_shuffle_epi8(g[i], m));
+        cpos += umorse_simd_lens[keys[i]];
+    }
+    return cpos;
+}
+
+__attribute__((target("ssse3")))
+static size_t _encode_sse(const char *text, size_t tlen, size_t *tpos,
+                          uint8_t *code, size_t clen)
+{
+    size_t cpos = 0;
+    size_t i = 0;
+
+    for (; ((i + 16) <= tlen) && ((cpos + UMORSE_SIMD_BLOCK_MAX) <= clen); i += 16) {
+        __m128i b0, b1, b2, len;
+        _classify_sse(_mm_loadu_si128((const __m128i *)(text + i)), &b0, &b1, &b2, &len);
+        cpos = _store_sse(b0, b1, b2, len, code, cpos);
+    }
+    *tpos = i;
+    return cpos;
+}
+
+__attribute__((target("avx2")))
+static size_t _encode_avx2(const char *text, size_t tlen, size_t *tpos,
+                           uint8_t *code, size_t clen)
+{
+    size_t cpos = 0;
+    size_t i = 0;
+
+    for (; ((i + 32) <= tlen) && ((cpos + 2 * UMORSE_SIMD_BLOCK_MAX) <= clen); i += 32) {
+        __m256i b0, b1, b2, len;
+        _classify_avx2(_mm256_loadu_si256((const __m256i *)(text + i)), &b0, &b1, &b2, &len);
+        /* compact each 128 bit lane */
+        cpos = _store_sse(_mm256_castsi256_si128(b0), _mm256_castsi256_si128(b1),
+                          _mm256_castsi256_si128(b2), _mm256_castsi256_si128(len),
+                          code, cpos);
+        cpos = _store_sse(_mm256_extracti128_si256(b0, 1), _mm256_extracti128_si256(b1, 1),
+                          _mm256_extracti128_si256(b2, 1), _mm256_extracti128_si256(len, 1),
+                          code, cpos);
+    }
+    *tpos = i;
+    return cpos;
+}
+
+static unsigned _supported(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return UMORSE_SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return UMORSE_SIMD_SSSE3;
+    }
+    return UMORSE_SIMD_NONE;
+}
+
+#else
+
+static unsigned _supported(void)
+{
+    return UMORSE_SIMD_NONE;
+}
+
+#endif /* UMORSE_SIMD_X86 */
+
+unsigned umorse_simd_level(void)
+{
+    unsigned level = _supported();
+
+    return (level < umorse_simd_max) ? level : umorse_simd_max;
+}
+
+unsigned umorse_simd_set_level(unsigned level)
+{
+    umorse_simd_max = level;
+    return umorse_simd_level();
+}
+
+int umorse_simd_encode_aligned(const char *text, size_t tlen,
+                               uint8_t *code, size_t clen)
+{
+    umorse_encoder_t enc;
+    size_t tpos = 0;
+    size_t cpos = 0;
+
+    if (clen < UMORSE_THRESHOLD) {
+        return -1;
+    }
+    /* keep room for the final stop char to close code */
+    clen -= UMORSE_THRESHOLD;
+#if UMORSE_SIMD_X86
+    switch (umorse_simd_level()) {
+        case UMORSE_SIMD_AVX2:
+            _init_tables();
+            cpos = _encode_avx2(text, tlen, &tpos, code, clen);
+            break;
+        case UMORSE_SIMD_SSSE3:
+            _init_tables();
+            cpos = _encode_sse(text, tlen, &tpos, code, clen);
+            break;
+        default:
+            break;
+    }
+#endif
+    /* the scalar tail counts the call, the vector part only its input */
+    UMORSE_STATS_ADD(encode_bytes, tpos);
+    /* scalar tail, also takes care of truncation */
+    umorse_encoder_init(&enc, UMORSE_CODE_ALIGNED);
+    cpos += umorse_encoder_feed(&enc, text + tpos, tlen - tpos, NULL,
+                                code + cpos, clen - cpos);
+    return cpos + umorse_encoder_finish(&enc, code + cpos,
+                                        clen + UMORSE_THRESHOLD - cpos);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a vectorized uMorse encoder for x86
+ *
+ * Encodes bulk text into aligned code 16 (SSSE3) or 32 (AVX2) bytes at a
+ * time: input is classified and case folded with vector compares, code words
+ * are looked up with byte shuffles and the variable length output of every
+ * 4 characters is compacted by a shuffle from a precomputed mask table. The
+ * remainder is passed on to the scalar encoder, such that the output is
+ * identical to umorse_encode_aligned. The instruction set is chosen at run
+ * time; on other platforms only the scalar encoder is used.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_SIMD_H
+#define UMORSE_SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Vector instruction sets
+ * @{
+ */
+#define UMORSE_SIMD_NONE        (0U)
+#define UMORSE_SIMD_SSSE3       (1U)
+#define UMORSE_SIMD_AVX2        (2U)
+/** @} */
+
+/**
+ * @brief   Returns the instruction set used by umorse_simd_encode_aligned
+ *
+ * @returns     one of UMORSE_SIMD_NONE, UMORSE_SIMD_SSSE3, UMORSE_SIMD_AVX2
+ */
+unsigned umorse_simd_level(void);
+
+/**
+ * @brief   Limits the instruction set used, e.g. for testing
+ *
+ * @param[in]   level   Highest instruction set to use
+ *
+ * @returns     the instruction set used from now on
+ */
+unsigned umorse_simd_set_level(unsigned level);
+
+/**
+ * @brief   Encodes a given sting into morse code in aligned mode
+ *
+ * @see     umorse_encode_aligned, the output is identical
+ *
+ * @param[in]   text    Input text string
+ * @param[in]   tlen    Length of input string
+ * @param[out]  code    Output buffer for encoded text
+ * @param[in]   clen    Length of output buffer
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 on error
+ */
+int umorse_simd_encode_aligned(const char *text, size_t tlen,
+                               uint8_t *code, size_t clen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_SIMD_H */
+/** @} */
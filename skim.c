@@ -0,0 +1,477 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a uMorse skimmer for many signals in one stream
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "keydec.h"
+#include "skim.h"
+#include "umorse.h"
+
+#ifndef M_PI
+#define M_PI                    (3.14159265358979323846)
+#endif
+
+#define UMORSE_SKIM_N           (UMORSE_SKIM_FFT_LEN)
+
+/* in place radix 2 FFT, decimation in time */
+static void _fft(const umorse_skim_t *skim, float *re, float *im)
+{
+    for (unsigned i = 0; i < UMORSE_SKIM_N; ++i) {
+        unsigned j = skim->rev[i];
+        if (j > i) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (unsigned len = 2; len <= UMORSE_SKIM_N; len <<= 1) {
+        unsigned half = len / 2;
+        unsigned step = UMORSE_SKIM_N / len;
+        for (unsigned i = 0; i < UMORSE_SKIM_N; i += len) {
+            for (unsigned k = 0; k < half; ++k) {
+                float wr = skim->twiddle[k * step][0];
+                float wi = skim->twiddle[k * step][1];
+                unsigned a = i + k;
+                unsigned b = a + half;
+                float xr = re[b] * wr + im[b] * wi;
+                float xi = im[b] * wr - re[b] * wi;
+                re[b] = re[a] - xr;
+                im[b] = im[a] - xi;
+                re[a] += xr;
+                im[a] += xi;
+            }
+        }
+    }
+}
+
+/* spectra of frames first to last, two real frames per complex FFT */
+static void _transform(umorse_skim_job_t *job)
+{
+    umorse_skim_t *skim = job->skim;
+    float re[UMORSE_SKIM_N];
+    float im[UMORSE_SKIM_N];
+    /* amplitude of a sine, the Hann window sums to N / 2 */
+    const float scale = 2.0f / UMORSE_SKIM_N;
+
+    for (unsigned f = job->first; f < job->last; f += 2) {
+        const int16_t *a = skim->buf + f * UMORSE_SKIM_HOP;
+        const int16_t *b = a + UMORSE_SKIM_HOP;
+        int pair = (f + 1) < job->frames;
+        for (unsigned i = 0; i < UMORSE_SKIM_N; ++i) {
+            re[i] = a[i] * skim->window[i];
+            im[i] = pair ? b[i] * skim->window[i] : 0;
+        }
+        _fft(skim, re, im);
+        /* split Z = A + iB by the symmetry of real transforms */
+        for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+            unsigned n = (UMORSE_SKIM_N - k) & (UMORSE_SKIM_N - 1);
+            float ar = re[k] + re[n];
+            float ai = im[k] - im[n];
+            skim->mag[f][k] = scale * sqrtf(ar * ar + ai * ai);
+            if (pair) {
+                float br = re[k] - re[n];
+                float bi = im[k] + im[n];
+                skim->mag[f + 1][k] = scale * sqrtf(br * br + bi * bi);
+            }
+        }
+    }
+}
+
+/* appends decoded text of a bin, the decoder itself always proceeds */
+static void _append(umorse_skim_bin_t *b, const char *text, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        if (b->tlen < UMORSE_SKIM_TEXT_LEN) {
+            b->text[b->tlen++] = text[i];
+        }
+        else {
+            ++b->dropped;
+        }
+    }
+}
+
+/* on/off tracking and decoding of bins first to last over all frames */
+static void _track(umorse_skim_job_t *job)
+{
+    umorse_skim_t *skim = job->skim;
+    char tmp[2];
+
+    for (unsigned k = job->first; k < job->last; ++k) {
+        umorse_skim_bin_t *b = &skim->bin[k];
+        for (unsigned f = 0; f < job->frames; ++f) {
+            /* mean of two frames, against single frame noise spikes */
+            float mag = (skim->mag[f][k] + b->prev) / 2;
+            b->prev = skim->mag[f][k];
+            b->peak *= UMORSE_SKIM_DECAY;
+            if (b->prev > b->peak) {
+                b->peak = b->prev;
+            }
+            b->active = b->owner && (b->peak > UMORSE_SKIM_FLOOR) &&
+                        (b->peak > UMORSE_SKIM_SNR * b->noise);
+            /* well below the peak and above the noise after a long gap */
+            float threshold = b->peak / UMORSE_SKIM_MARK;
+            if (threshold < UMORSE_SKIM_KEY * b->noise) {
+                threshold = UMORSE_SKIM_KEY * b->noise;
+            }
+            uint8_t on = b->active && (mag > threshold);
+
+            if (on != b->on) {
+                if (b->held) {
+                    /* shorter than half a dit, a noise spike or a fade */
+                    b->dur += b->held;
+                    b->held = 0;
+                }
+                else {
+                    b->held = b->dur;
+                    b->dur = 0;
+                }
+                b->on = on;
+            }
+            b->dur += UMORSE_SKIM_HOP;
+            if (b->held && (2 * b->dur >= b->dec.mark[0])) {
+                /* the level lasts, so the one before was no glitch */
+                umorse_key_t key = (on ? 0 : UMORSE_KEY_ON) | b->held;
+                _append(b, tmp, umorse_keydec_put(&b->dec, key, tmp, sizeof(tmp)));
+                b->held = 0;
+            }
+            if (!on) {
+                if (!b->active) {
+                    /* silence before a signal is a word gap, which
+                     * neither adapts the decoder nor emits text */
+                    b->dur = b->dec.space[2];
+                }
+                if (!b->held) {
+                    _append(b, tmp, umorse_keydec_idle(&b->dec, b->dur, tmp, sizeof(tmp)));
+                }
+                /* noise is the mean level with the key up for a whole frame,
+                 * without the tone of a neighbour in a bin not owning it */
+                if ((b->dur >= UMORSE_SKIM_N) && (mag < UMORSE_SKIM_KEY * b->noise)) {
+                    b->noise += (mag - b->noise) / 32;
+                }
+            }
+        }
+    }
+}
+
+/* worker i runs job i of each round, until a round without work */
+static void *_worker(void *arg)
+{
+    umorse_skim_job_t *job = arg;
+    umorse_skim_t *skim = job->skim;
+    unsigned index = (unsigned)(job - skim->jobs);
+    unsigned round = 0;
+
+    pthread_mutex_lock(&skim->lock);
+    for (;;) {
+        while (skim->round == round) {
+            pthread_cond_wait(&skim->wake, &skim->lock);
+        }
+        round = skim->round;
+        if (skim->fn == NULL) {
+            break;
+        }
+        if (index < skim->cnt) {
+            pthread_mutex_unlock(&skim->lock);
+            skim->fn(job);
+            pthread_mutex_lock(&skim->lock);
+            if (--skim->pending == 0) {
+                pthread_cond_signal(&skim->idle);
+            }
+        }
+    }
+    pthread_mutex_unlock(&skim->lock);
+    return NULL;
+}
+
+/* run fn on all jobs, the calling thread takes those without a worker */
+static void _run(umorse_skim_t *skim, void (*fn)(umorse_skim_job_t *job),
+                 unsigned cnt)
+{
+    unsigned workers = (skim->workers < cnt) ? skim->workers : cnt;
+
+    pthread_mutex_lock(&skim->lock);
+    skim->fn = fn;
+    skim->cnt = cnt;
+    skim->pending = workers - 1;
+    ++skim->round;
+    pthread_cond_broadcast(&skim->wake);
+    pthread_mutex_unlock(&skim->lock);
+    fn(&skim->jobs[0]);
+    for (unsigned i = workers; i < cnt; ++i) {
+        fn(&skim->jobs[i]);
+    }
+    pthread_mutex_lock(&skim->lock);
+    while (skim->pending > 0) {
+        pthread_cond_wait(&skim->idle, &skim->lock);
+    }
+    pthread_mutex_unlock(&skim->lock);
+}
+
+/* splits cnt items into jobs of even size, returns number of jobs */
+static unsigned _split(umorse_skim_t *skim, unsigned cnt, unsigned frames)
+{
+    umorse_skim_job_t *jobs = skim->jobs;
+    unsigned n = (skim->threads < cnt) ? skim->threads : cnt;
+    unsigned first = 0;
+
+    for (unsigned i = 0; i < n; ++i) {
+        /* frames are transformed in pairs */
+        unsigned len = ((cnt - first) / (n - i) + 1) & ~1U;
+        jobs[i].first = first;
+        jobs[i].last = (first + len < cnt) ? first + len : cnt;
+        jobs[i].frames = frames;
+        first = jobs[i].last;
+    }
+    return n;
+}
+
+static int _cmp(const void *a, const void *b)
+{
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* noise floor of all bins at start, the median level of the first batch */
+static void _init_noise(umorse_skim_t *skim, unsigned frames)
+{
+    float mean[UMORSE_SKIM_BINS];
+
+    for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+        mean[k] = 0;
+        for (unsigned f = 0; f < frames; ++f) {
+            mean[k] += skim->mag[f][k];
+        }
+        mean[k] /= frames;
+    }
+    qsort(mean, UMORSE_SKIM_BINS, sizeof(mean[0]), _cmp);
+    for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+        skim->bin[k].noise = mean[UMORSE_SKIM_BINS / 2];
+    }
+}
+
+/* a signal that moves to a neighbouring bin takes its decoder along */
+static void _move(umorse_skim_bin_t *from, umorse_skim_bin_t *to)
+{
+    umorse_skim_bin_t tmp = *to;
+
+    to->peak = from->peak;
+    to->on = from->on;
+    to->dur = from->dur;
+    to->held = from->held;
+    to->dec = from->dec;
+    _append(to, from->text, from->tlen);
+    from->peak = tmp.peak;
+    from->on = tmp.on;
+    from->dur = tmp.dur;
+    from->held = tmp.held;
+    from->dec = tmp.dec;
+    from->tlen = 0;
+}
+
+/* spectra, ownership and decoding of a batch, returns active bins */
+static int _batch(umorse_skim_t *skim, unsigned frames)
+{
+    int active = 0;
+
+    _run(skim, _transform, _split(skim, frames, frames));
+    if (skim->bin[0].noise == 0) {
+        _init_noise(skim, frames);
+    }
+    for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+        float level = skim->level[k];
+        for (unsigned f = 0; f < frames; ++f) {
+            level *= UMORSE_SKIM_DECAY;
+            if (skim->mag[f][k] > level) {
+                level = skim->mag[f][k];
+            }
+        }
+        skim->level[k] = level;
+    }
+    /* a signal belongs to the bin with the highest level, which keeps it
+     * until a neighbour is higher by UMORSE_SKIM_HOLD, as a tone between
+     * two bins would switch back and forth otherwise */
+    for (unsigned k = 1; k < UMORSE_SKIM_BINS; ++k) {
+        int owner = 1;
+        for (unsigned j = k - 1; (j <= k + 1) && (j < UMORSE_SKIM_BINS); j += 2) {
+            float level = skim->level[k] * (skim->bin[k].active ? UMORSE_SKIM_HOLD : 1);
+            float other = skim->level[j] * (skim->bin[j].active ? UMORSE_SKIM_HOLD : 1);
+            owner &= (level > other) || ((level == other) && (j > k));
+        }
+        skim->owner[k] = (uint8_t)owner;
+    }
+    for (unsigned k = 1; k < UMORSE_SKIM_BINS; ++k) {
+        for (unsigned j = k - 1; (j <= k + 1) && (j < UMORSE_SKIM_BINS); j += 2) {
+            if (skim->owner[k] && !skim->bin[k].owner &&
+                skim->bin[j].active && !skim->owner[j]) {
+                _move(&skim->bin[j], &skim->bin[k]);
+            }
+        }
+    }
+    for (unsigned k = 1; k < UMORSE_SKIM_BINS; ++k) {
+        skim->bin[k].owner = skim->owner[k];
+    }
+    _run(skim, _track, _split(skim, UMORSE_SKIM_BINS, frames));
+    for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+        active += skim->bin[k].active;
+    }
+    return active;
+}
+
+int umorse_skim_init(umorse_skim_t *skim, uint32_t rate, unsigned dit_ms,
+                     unsigned threads)
+{
+    unsigned bits = 0;
+
+    if ((rate == 0) || (dit_ms == 0) || (UMORSE_SKIM_FRAMES % 2) ||
+        (UMORSE_SKIM_N & (UMORSE_SKIM_N - 1))) {
+        return -1;
+    }
+    while ((1U << bits) < UMORSE_SKIM_N) {
+        ++bits;
+    }
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (unsigned)cpus : 1;
+    }
+    if (threads > UMORSE_SKIM_THREADS_MAX) {
+        threads = UMORSE_SKIM_THREADS_MAX;
+    }
+    skim->rate = rate;
+    skim->threads = threads;
+    /* half a frame of silence centers the first frame on the first sample */
+    memset(skim->buf, 0, UMORSE_SKIM_N / 2 * sizeof(skim->buf[0]));
+    skim->fill = UMORSE_SKIM_N / 2;
+    for (unsigned i = 0; i < UMORSE_SKIM_N; ++i) {
+        unsigned r = 0;
+        for (unsigned j = 0; j < bits; ++j) {
+            r |= ((i >> j) & 1U) << (bits - 1 - j);
+        }
+        skim->rev[i] = (uint16_t)r;
+        skim->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / UMORSE_SKIM_N));
+    }
+    for (unsigned i = 0; i < UMORSE_SKIM_N / 2; ++i) {
+        skim->twiddle[i][0] = (float)cos(2.0 * M_PI * i / UMORSE_SKIM_N);
+        skim->twiddle[i][1] = (float)sin(2.0 * M_PI * i / UMORSE_SKIM_N);
+    }
+    /* decode table is built on first use, not by the worker threads */
+    umorse_decode_char(0);
+    memset(skim->level, 0, sizeof(skim->level));
+    memset(skim->bin, 0, sizeof(skim->bin));
+    for (unsigned k = 0; k < UMORSE_SKIM_BINS; ++k) {
+        umorse_keydec_init(&skim->bin[k].dec, (rate * dit_ms) / 1000U);
+    }
+    /* workers wait for batches, the caller is the first of the threads */
+    pthread_mutex_init(&skim->lock, NULL);
+    pthread_cond_init(&skim->wake, NULL);
+    pthread_cond_init(&skim->idle, NULL);
+    skim->fn = NULL;
+    skim->round = 0;
+    skim->workers = 1;
+    for (unsigned i = 0; i < threads; ++i) {
+        skim->jobs[i].skim = skim;
+    }
+    while ((skim->workers < threads) &&
+           (pthread_create(&skim->tids[skim->workers], NULL, _worker,
+                           &skim->jobs[skim->workers]) == 0)) {
+        ++skim->workers;
+    }
+    return 0;
+}
+
+void umorse_skim_close(umorse_skim_t *skim)
+{
+    pthread_mutex_lock(&skim->lock);
+    skim->fn = NULL;
+    ++skim->round;
+    pthread_cond_broadcast(&skim->wake);
+    pthread_mutex_unlock(&skim->lock);
+    for (unsigned i = 1; i < skim->workers; ++i) {
+        pthread_join(skim->tids[i], NULL);
+    }
+    skim->workers = 1;
+    pthread_cond_destroy(&skim->idle);
+    pthread_cond_destroy(&skim->wake);
+    pthread_mutex_destroy(&skim->lock);
+}
+
+int umorse_skim_process(umorse_skim_t *skim, const int16_t *samples, size_t len)
+{
+    const size_t size = sizeof(skim->buf) / sizeof(skim->buf[0]);
+    int active = 0;
+
+    for (size_t i = 0; i < len; ) {
+        size_t n = size - skim->fill;
+        if (n > len - i) {
+            n = len - i;
+        }
+        memcpy(skim->buf + skim->fill, samples + i, n * sizeof(samples[0]));
+        skim->fill += n;
+        i += n;
+        if (skim->fill < UMORSE_SKIM_N) {
+            break;
+        }
+        unsigned frames = (unsigned)((skim->fill - UMORSE_SKIM_N) / UMORSE_SKIM_HOP) + 1;
+        int batch = _batch(skim, frames);
+        if (batch > active) {
+            active = batch;
+        }
+        /* keep the overlap with the next frame */
+        size_t used = (size_t)frames * UMORSE_SKIM_HOP;
+        memmove(skim->buf, skim->buf + used, (skim->fill - used) * sizeof(skim->buf[0]));
+        skim->fill -= used;
+    }
+    return active;
+}
+
+unsigned umorse_skim_freq(const umorse_skim_t *skim, unsigned bin)
+{
+    return (unsigned)(((uint64_t)bin * skim->rate) / UMORSE_SKIM_N);
+}
+
+int umorse_skim_read(umorse_skim_t *skim, unsigned bin, char *text, size_t tlen)
+{
+    umorse_skim_bin_t *b;
+
+    if (bin >= UMORSE_SKIM_BINS) {
+        return -1;
+    }
+    b = &skim->bin[bin];
+    if (tlen > b->tlen) {
+        tlen = b->tlen;
+    }
+    memcpy(text, b->text, tlen);
+    memmove(b->text, b->text + tlen, b->tlen - tlen);
+    b->tlen -= (uint16_t)tlen;
+    return (int)tlen;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse skimmer for many signals in one stream
+ *
+ * Decodes all Morse signals within a wide audio passband at once. The 16
+ * bit mono PCM stream is cut into Hann windowed frames that overlap by 3/4
+ * and transformed by an FFT, two real frames per complex transform, which
+ * yields a filter bank of UMORSE_SKIM_BINS channels. A bin carries a signal
+ * if its decaying peak level stands out from its noise floor and is above
+ * that of both neighbours, such that a tone between two bins is decoded
+ * once. The owning bin keeps a signal until a neighbour is clearly higher,
+ * and then hands over its decoder and unread text. Each bin runs its own
+ * on/off tracker, like umorse_tone, which drops levels shorter than half a
+ * dit as noise spikes or fading, and an adaptive key decoder, so signals of
+ * any speed decode independently.
+ *
+ * Frames of a chunk are transformed in parallel by worker threads, and
+ * then the bins are tracked in parallel, in ranges per thread. The workers
+ * are started by umorse_skim_init and wait for each batch until stopped by
+ * umorse_skim_close. Text is
+ * buffered per bin until read by umorse_skim_read. The state is large,
+ * mostly for the spectra of a whole batch of frames, so allocate it
+ * statically.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_SKIM_H
+#define UMORSE_SKIM_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "keydec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Skimmer parameters
+ * @{
+ */
+#ifndef UMORSE_SKIM_FFT_LEN
+#define UMORSE_SKIM_FFT_LEN     (512U)  /**< FFT length, power of 2 */
+#endif
+#ifndef UMORSE_SKIM_FRAMES
+#define UMORSE_SKIM_FRAMES      (256U)  /**< max frames per batch, even */
+#endif
+#ifndef UMORSE_SKIM_TEXT_LEN
+#define UMORSE_SKIM_TEXT_LEN    (64U)   /**< unread text per bin */
+#endif
+#ifndef UMORSE_SKIM_THREADS_MAX
+#define UMORSE_SKIM_THREADS_MAX (64U)   /**< max number of threads */
+#endif
+#ifndef UMORSE_SKIM_SNR
+#define UMORSE_SKIM_SNR         (4.0f)  /**< min ratio of peak to noise */
+#endif
+#ifndef UMORSE_SKIM_KEY
+#define UMORSE_SKIM_KEY         (2.5f)  /**< min ratio of key down to noise */
+#endif
+#ifndef UMORSE_SKIM_MARK
+#define UMORSE_SKIM_MARK        (2.5f)  /**< max ratio of peak to key down */
+#endif
+#ifndef UMORSE_SKIM_FLOOR
+#define UMORSE_SKIM_FLOOR       (20)    /**< min amplitude of a signal */
+#endif
+#define UMORSE_SKIM_DECAY       (0.997f) /**< peak decay per frame */
+#define UMORSE_SKIM_HOLD        (1.5f)  /**< level margin of the owning bin */
+#define UMORSE_SKIM_HOP         (UMORSE_SKIM_FFT_LEN / 4)
+#define UMORSE_SKIM_BINS        (UMORSE_SKIM_FFT_LEN / 2 + 1)
+/** @} */
+
+/**
+ * @brief   State of a single bin
+ */
+typedef struct {
+    float prev;         /**< amplitude of the previous frame */
+    float peak;         /**< decaying peak amplitude */
+    float noise;        /**< noise floor amplitude */
+    uint32_t dur;       /**< samples since the last key level change */
+    uint32_t held;      /**< samples of the previous level, not yet decoded */
+    uint32_t dropped;   /**< chars lost as the text buffer was full */
+    uint8_t on;         /**< current key level */
+    uint8_t owner;      /**< 1 if the bin owns the signal around it */
+    uint8_t active;     /**< 1 if the bin carries a signal */
+    uint16_t tlen;      /**< length of unread text */
+    char text[UMORSE_SKIM_TEXT_LEN];    /**< unread text */
+    umorse_keydec_t dec;    /**< decoder of key durations */
+} umorse_skim_bin_t;
+
+struct umorse_skim;
+
+/**
+ * @brief   Share of a batch for one thread, frames or bins
+ */
+typedef struct {
+    struct umorse_skim *skim;   /**< skimmer of the job */
+    unsigned first;     /**< first frame or bin */
+    unsigned last;      /**< one past the last frame or bin */
+    unsigned frames;    /**< frames in the batch */
+} umorse_skim_job_t;
+
+/**
+ * @brief   Skimmer state
+ */
+typedef struct umorse_skim {
+    uint32_t rate;      /**< sample rate in Hz */
+    unsigned threads;   /**< number of threads */
+    unsigned workers;   /**< threads running, the caller included */
+    pthread_t tids[UMORSE_SKIM_THREADS_MAX];    /**< worker threads */
+    umorse_skim_job_t jobs[UMORSE_SKIM_THREADS_MAX];    /**< jobs by thread */
+    pthread_mutex_t lock;   /**< guards the round of jobs */
+    pthread_cond_t wake;    /**< signals the workers a new round */
+    pthread_cond_t idle;    /**< signals the caller the end of a round */
+    void (*fn)(umorse_skim_job_t *job); /**< work of the round, NULL to stop */
+    unsigned round;     /**< rounds started */
+    unsigned cnt;       /**< jobs in the round */
+    unsigned pending;   /**< jobs of workers not yet done */
+    size_t fill;        /**< samples in buf */
+    float window[UMORSE_SKIM_FFT_LEN];      /**< Hann window */
+    float twiddle[UMORSE_SKIM_FFT_LEN / 2][2];  /**< cos and sin of the FFT */
+    uint16_t rev[UMORSE_SKIM_FFT_LEN];      /**< bit reversed indexes */
+    float level[UMORSE_SKIM_BINS];          /**< peak of each bin at batch end */
+    uint8_t owner[UMORSE_SKIM_BINS];        /**< owners of the next batch */
+    int16_t buf[UMORSE_SKIM_FFT_LEN - UMORSE_SKIM_HOP +
+                UMORSE_SKIM_FRAMES * UMORSE_SKIM_HOP];  /**< pending samples */
+    float mag[UMORSE_SKIM_FRAMES][UMORSE_SKIM_BINS];    /**< spectra of a batch */
+    umorse_skim_bin_t bin[UMORSE_SKIM_BINS];            /**< bin states */
+} umorse_skim_t;
+
+/**
+ * @brief   Initializes a skimmer and starts its worker threads
+ *
+ * Threads that fail to start leave their share to the caller.
+ *
+ * @param[out]  skim    Skimmer state
+ * @param[in]   rate    Sample rate in Hz
+ * @param[in]   dit_ms  Initial estimate of the dit duration in milli seconds
+ * @param[in]   threads Number of threads, 0 for one per online CPU
+ *
+ * @returns     0 on success
+ * @returns     < 0 on invalid parameters
+ */
+int umorse_skim_init(umorse_skim_t *skim, uint32_t rate, unsigned dit_ms,
+                     unsigned threads);
+
+/**
+ * @brief   Decodes the next chunk of PCM samples
+ *
+ * All complete frames are processed before return, so text lags the input
+ * by less than a frame. Chunks of some 100 ms and longer keep the cost of
+ * waking the workers low.
+ *
+ * @param[in,out]   skim    Skimmer state
+ * @param[in]       samples Input samples
+ * @param[in]       len     Number of input samples
+ *
+ * @returns     max number of bins carrying a signal at the end of a batch,
+ *              over all batches of the chunk, 0 if none completed
+ */
+int umorse_skim_process(umorse_skim_t *skim, const int16_t *samples, size_t len);
+
+/**
+ * @brief   Stops the worker threads of a skimmer
+ *
+ * Text not read yet stays available, but no further chunks are processed
+ * until umorse_skim_init is called again.
+ *
+ * @param[in,out]   skim    Skimmer state
+ */
+void umorse_skim_close(umorse_skim_t *skim);
+
+/**
+ * @brief   Returns the center frequency of a bin
+ *
+ * @param[in]   skim    Skimmer state
+ * @param[in]   bin     Bin index, below UMORSE_SKIM_BINS
+ *
+ * @returns     frequency in Hz
+ */
+unsigned umorse_skim_freq(const umorse_skim_t *skim, unsigned bin);
+
+/**
+ * @brief   Reads and clears the text decoded in a bin
+ *
+ * Word gaps and stops both decode to ' ', as of umorse_tone_process.
+ *
+ * @param[in,out]   skim    Skimmer state
+ * @param[in]       bin     Bin index, below UMORSE_SKIM_BINS
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer
+ *
+ * @returns     length of text written to output buffer
+ * @returns     < 0 on an invalid bin
+ */
+int umorse_skim_read(umorse_skim_t *skim, unsigned bin, char *text, size_t tlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_SKIM_H */
+/** @} */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of uMorse instrumentation counters
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "stats.h"
+
+#if UMORSE_STATS
+umorse_stats_t umorse_stats;
+
+/* the struct is a plain array of counters */
+#define UMORSE_STATS_NUMOF      (sizeof(umorse_stats_t) / sizeof(uint64_t))
+
+void umorse_stats_latency(unsigned cb, uint64_t ns)
+{
+    unsigned k = 0;
+    uint64_t max = __atomic_load_n(&umorse_stats.latency_max[cb], __ATOMIC_RELAXED);
+
+    while ((k + 1 < UMORSE_STATS_BUCKETS) && (ns >> (k + 1))) {
+        ++k;
+    }
+    __atomic_fetch_add(&umorse_stats.callbacks[cb], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&umorse_stats.latency[cb][k], 1, __ATOMIC_RELAXED);
+    while ((ns > max) &&
+           !__atomic_compare_exchange_n(&umorse_stats.latency_max[cb], &max, ns, 0,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+int umorse_stats_snapshot(umorse_stats_t *stats)
+{
+    const uint64_t *src = (const uint64_t *)&umorse_stats;
+    uint64_t *dst = (uint64_t *)stats;
+
+    for (size_t i = 0; i < UMORSE_STATS_NUMOF; ++i) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+void umorse_stats_reset(void)
+{
+    uint64_t *dst = (uint64_t *)&umorse_stats;
+
+    for (size_t i = 0; i < UMORSE_STATS_NUMOF; ++i) {
+        __atomic_store_n(&dst[i], 0, __ATOMIC_RELAXED);
+    }
+}
+#else
+int umorse_stats_snapshot(umorse_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    return -1;
+}
+
+void umorse_stats_reset(void)
+{
+}
+#endif
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of uMorse instrumentation counters
+ *
+ * Build with UMORSE_STATS set to 1 to count calls, ignored input bytes and
+ * truncated outputs of encode, decode and output, and to measure how long
+ * each output callback takes. Output runs and their elements are counted
+ * apart, the same way on every output path. Counters are updated atomically, such that
+ * parallel encoding and the scheduler may be instrumented as well. With
+ * UMORSE_STATS 0, the default, all hooks expand to nothing and
+ * umorse_stats_snapshot reports zeros.
+ *
+ * Latencies are taken with UMORSE_STATS_CLOCK, which returns nano seconds
+ * of a monotonic clock and may be replaced on platforms without POSIX
+ * clocks.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_STATS_H
+#define UMORSE_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Instrumentation options
+ * @{
+ */
+#ifndef UMORSE_STATS
+#define UMORSE_STATS            (0)
+#endif
+#define UMORSE_STATS_BUCKETS    (32U)   /**< latency buckets, by powers of 2 */
+/** @} */
+
+/**
+ * @name Output callbacks with latency histograms
+ * @{
+ */
+#define UMORSE_STATS_DIT        (0U)
+#define UMORSE_STATS_DAH        (1U)
+#define UMORSE_STATS_NIL        (2U)
+#define UMORSE_STATS_BATCH      (3U)
+#define UMORSE_STATS_CB_NUMOF   (4U)
+/** @} */
+
+/**
+ * @brief   Counters, all of them uint64_t
+ */
+typedef struct {
+    uint64_t encode_calls;      /**< calls of umorse_encoder_feed */
+    uint64_t encode_bytes;      /**< input bytes consumed */
+    uint64_t encode_skipped;    /**< input bytes without code word */
+    uint64_t encode_truncated;  /**< calls stopped before the end of input */
+    uint64_t decode_calls;      /**< calls of decode and decoder feed */
+    uint64_t decode_unknown;    /**< unknown or too long code words */
+    uint64_t decode_truncated;  /**< calls stopped before the end of code */
+    uint64_t output_calls;      /**< output runs: calls of umorse_output and
+                                     umorse_ring_output with code, jobs added
+                                     to the scheduler */
+    uint64_t output_elements;   /**< elements output, dits, dahs and nils,
+                                     alike for single and batch callbacks */
+    uint64_t callbacks[UMORSE_STATS_CB_NUMOF];  /**< calls per callback */
+    uint64_t latency_max[UMORSE_STATS_CB_NUMOF];    /**< in nano seconds */
+    /** calls per duration, bucket k counts [2^k, 2^(k+1)) nano seconds and
+     *  the last one everything beyond */
+    uint64_t latency[UMORSE_STATS_CB_NUMOF][UMORSE_STATS_BUCKETS];
+} umorse_stats_t;
+
+/**
+ * @brief   Copies the current counters
+ *
+ * Each counter is read atomically, the copy as a whole is not a consistent
+ * snapshot while other threads keep updating.
+ *
+ * @param[out]  stats   Copy of the counters, zeros if disabled
+ *
+ * @returns     0 on success
+ * @returns     < 0 if built without UMORSE_STATS
+ */
+int umorse_stats_snapshot(umorse_stats_t *stats);
+
+/**
+ * @brief   Sets all counters to 0
+ */
+void umorse_stats_reset(void);
+
+#if UMORSE_STATS
+#ifndef UMORSE_STATS_CLOCK
+#include <time.h>
+static inline uint64_t umorse_stats_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#define UMORSE_STATS_CLOCK()    umorse_stats_clock()
+#endif
+
+extern umorse_stats_t umorse_stats;
+
+/**
+ * @brief   Records the duration of a callback, see UMORSE_STATS_CALL
+ *
+ * @param[in]   cb      Callback, UMORSE_STATS_DIT to UMORSE_STATS_BATCH
+ * @param[in]   ns      Duration in nano seconds
+ */
+void umorse_stats_latency(unsigned cb, uint64_t ns);
+
+/** adds n to a counter of umorse_stats */
+#define UMORSE_STATS_ADD(field, n) \
+    __atomic_fetch_add(&umorse_stats.field, (n), __ATOMIC_RELAXED)
+
+/** makes a callback call and records its duration */
+#define UMORSE_STATS_CALL(cb, call)                                 \
+    do {                                                            \
+        uint64_t umorse_stats_t0 = UMORSE_STATS_CLOCK();            \
+        call;                                                       \
+        umorse_stats_latency((cb), UMORSE_STATS_CLOCK() - umorse_stats_t0); \
+    } while (0)
+#else
+#define UMORSE_STATS_ADD(field, n)
+#define UMORSE_STATS_CALL(cb, call)     call
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_STATS_H */
+/** @} */
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Symbol list of uMorse, the single source of all code words
+ *
+ * UMORSE_SYMBOLS(X) expands X(chr, cw) for every character with a code
+ * word, where cw holds its elements packed from LSB onwards. The encode
+ * table, the decode hash and the compile-time encoder of umorse.h are all
+ * generated from it, so a symbol is added here only. Lower case letters
+ * are folded to upper case. Prosigns without a character of their own are
+ * mapped to rarely used ones, SK to '>'.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+
+/* outside the guard, as umorse.h includes this file for C++ */
+#include "umorse.h"
+
+#ifndef UMORSE_SYMBOLS_H
+#define UMORSE_SYMBOLS_H
+
+/**
+ * @brief   Packs up to UMORSE_DECODE_MAX elements into a code word
+ */
+#define UMORSE_CW(...)          UMORSE_CW_(__VA_ARGS__, 0, 0, 0, 0, 0, 0)
+#define UMORSE_CW_(e0, e1, e2, e3, e4, e5, ...) \
+    ((e0) | ((e1) << (1 * UMORSE_SHIFT)) | ((e2) << (2 * UMORSE_SHIFT)) | \
+     ((e3) << (3 * UMORSE_SHIFT)) | ((e4) << (4 * UMORSE_SHIFT)) | \
+     ((e5) << (5 * UMORSE_SHIFT)))
+
+/**
+ * @brief   All characters and their code words
+ */
+#define UMORSE_SYMBOLS(X) \
+    X('A', UMORSE_CW(UMORSE_DIT, UMORSE_DAH)) \
+    X('B', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('C', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('D', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT)) \
+    X('E', UMORSE_CW(UMORSE_DIT)) \
+    X('F', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('G', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DIT)) \
+    X('H', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('I', UMORSE_CW(UMORSE_DIT, UMORSE_DIT)) \
+    X('J', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH)) \
+    X('K', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) \
+    X('L', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT)) \
+    X('M', UMORSE_CW(UMORSE_DAH, UMORSE_DAH)) \
+    X('N', UMORSE_CW(UMORSE_DAH, UMORSE_DIT)) \
+    X('O', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DAH)) \
+    X('P', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT)) \
+    X('Q', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) \
+    X('R', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('S', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('T', UMORSE_CW(UMORSE_DAH)) \
+    X('U', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) \
+    X('V', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) \
+    X('W', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH)) \
+    X('X', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) \
+    X('Y', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH)) \
+    X('Z', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT)) \
+    X('0', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH)) \
+    X('1', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH)) \
+    X('2', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH)) \
+    X('3', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH)) \
+    X('4', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) \
+    X('5', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('6', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('7', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X('8', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT)) \
+    X('9', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT)) \
+    X('.', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) \
+    X(',', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH)) \
+    X('?', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT)) \
+    X('\'', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT)) \
+    X('!', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH)) \
+    X('/', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('(', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT)) /* KN */ \
+    X(')', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) \
+    X('&', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) /* AS */ \
+    X(':', UMORSE_CW(UMORSE_DAH, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT)) \
+    X(';', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('=', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) /* BT */ \
+    X('+', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) /* AR */ \
+    X('-', UMORSE_CW(UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH)) \
+    X('_', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) \
+    X('"', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('@', UMORSE_CW(UMORSE_DIT, UMORSE_DAH, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT)) \
+    X('>', UMORSE_CW(UMORSE_DIT, UMORSE_DIT, UMORSE_DIT, UMORSE_DAH, UMORSE_DIT, UMORSE_DAH)) /* SK */
+
+#endif /* UMORSE_SYMBOLS_H */
+/** @} */
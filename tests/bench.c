@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse_tests
+ * @{
+ * @file
+ * @brief       Throughput benchmark of uMorse encode, decode, render, bitmap
+ *              and output
+ *
+ * Prints one record per operation and corpus, as CSV by default or as JSON
+ * with argument "json". Rates refer to bytes of input text. The reference
+ * encoders are the branchy loop the lookup table replaced. The UTF-8
+ * encoder is run on all corpora, the mixed one compares its multibyte path
+ * to pure ASCII, random input to invalid sequences. The vector encoder is
+ * run once per instruction set the CPU supports, the parallel encoder with
+ * one thread per online CPU.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "umorse.h"
+#include "bitmap.h"
+#include "convert.h"
+#include "parallel.h"
+#include "reference.h"
+#include "simd.h"
+#include "utf8.h"
+
+#ifndef BENCH_CORPUS_LEN
+#define BENCH_CORPUS_LEN    (1U << 20)
+#endif
+
+#ifndef BENCH_MIN_NS
+#define BENCH_MIN_NS        (200000000ULL)  /* per operation and corpus */
+#endif
+
+typedef struct {
+    const char *name;
+    const char *chars;  /* chars drawn from, NULL for any byte */
+} corpus_t;
+
+static const corpus_t corpora[] = {
+    { "letters",    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz" },
+    { "digits",     "0123456789012345678901234567890123456789 abcdef" },
+    { "whitespace", "     \t\t   e t a    \n\n" },
+    { "mixed",      "CQ de DL0ABC 73 Привет мир Καλημέρα κόσμε こんにちは ガパ" },
+    { "random",     NULL },
+};
+
+static char text[BENCH_CORPUS_LEN];
+static uint8_t code[4 * BENCH_CORPUS_LEN];
+static char decoded[16 * BENCH_CORPUS_LEN];
+static uint8_t rendered[4 * BENCH_CORPUS_LEN];
+
+static void _nop(void *args, uint8_t flags)
+{
+    (void) args;
+    (void) flags;
+}
+
+static void _nop_batch(void *args, const uint8_t *span, size_t len, uint8_t flags)
+{
+    (void) args;
+    (void) span;
+    (void) len;
+    (void) flags;
+}
+
+static const umorse_out_t out_nop = {
+    .dit = _nop, .dah = _nop, .nil = _nop, .params = NULL
+};
+
+static const umorse_out_t out_nop_batch = {
+    .params = NULL, .batch = _nop_batch
+};
+
+static int clen;   /* length of code for the current corpus and mode */
+
+static int _encode_aligned(void)
+{
+    return umorse_encode_aligned(text, sizeof(text), code, sizeof(code));
+}
+
+static int _encode_compact(void)
+{
+    return umorse_encode_compact(text, sizeof(text), code, sizeof(code));
+}
+
+static int _encode_aligned_reference(void)
+{
+    return umorse_encode_reference(text, sizeof(text), code, sizeof(code),
+                                   UMORSE_CODE_ALIGNED);
+}
+
+static int _encode_compact_reference(void)
+{
+    return umorse_encode_reference(text, sizeof(text), code, sizeof(code),
+                                   UMORSE_CODE_COMPACT);
+}
+
+static int _encode_dense(void)
+{
+    return umorse_encode_dense(text, sizeof(text), code, sizeof(code));
+}
+
+static int _encode_simd(void)
+{
+    return umorse_simd_encode_aligned(text, sizeof(text), code, sizeof(code));
+}
+
+static int _encode_parallel(uint8_t flags)
+{
+    size_t cused;
+
+    if (umorse_encode_parallel(text, sizeof(text), code, sizeof(code),
+                               &cused, flags, 0) < 0) {
+        return -1;
+    }
+    return (int)cused;
+}
+
+static int _encode_parallel_aligned(void)
+{
+    return _encode_parallel(UMORSE_CODE_ALIGNED);
+}
+
+static int _encode_parallel_compact(void)
+{
+    return _encode_parallel(UMORSE_CODE_COMPACT);
+}
+
+static int _encode_utf8_aligned(void)
+{
+    return umorse_utf8_encode(text, sizeof(text), code, sizeof(code),
+                              UMORSE_CODE_ALIGNED, UMORSE_ALPHABET_ALL);
+}
+
+static int _encode_utf8_compact(void)
+{
+    return umorse_utf8_encode(text, sizeof(text), code, sizeof(code),
+                              UMORSE_CODE_COMPACT, UMORSE_ALPHABET_ALL);
+}
+
+static int _decode_dense(void)
+{
+    return umorse_decode_dense(code, clen, decoded, sizeof(decoded));
+}
+
+static int _decode(void)
+{
+    return umorse_decode(code, clen, decoded, sizeof(decoded));
+}
+
+static int _render(void)
+{
+    return umorse_render(code, clen, decoded, sizeof(decoded));
+}
+
+static int _bitmap(void)
+{
+    return umorse_bitmap(code, clen, rendered, sizeof(rendered));
+}
+
+static int _convert_compact(void)
+{
+    return umorse_convert_compact(code, clen, rendered, sizeof(rendered));
+}
+
+static int _convert_aligned(void)
+{
+    return umorse_convert_aligned(code, clen, rendered, sizeof(rendered));
+}
+
+static int _output(void)
+{
+    return umorse_output(&out_nop, code, clen, UMORSE_FLAG_NODELAY);
+}
+
+static int _output_batch(void)
+{
+    return umorse_output(&out_nop_batch, code, clen, UMORSE_FLAG_NODELAY);
+}
+
+typedef struct {
+    const char *name;
+    int (*fn)(void);
+    uint8_t flags;      /* code mode to prepare, if encode is not measured */
+    unsigned simd;      /* instruction set, skipped if not supported */
+} op_t;
+
+static const op_t ops[] = {
+    { "encode_aligned",           _encode_aligned,           UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "encode_compact",           _encode_compact,           UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "encode_aligned_reference", _encode_aligned_reference, UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "encode_compact_reference", _encode_compact_reference, UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "encode_dense",             _encode_dense,             UMORSE_CODE_DENSE,   UMORSE_SIMD_NONE },
+    { "encode_simd_none",         _encode_simd,              UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "encode_simd_ssse3",        _encode_simd,              UMORSE_CODE_ALIGNED, UMORSE_SIMD_SSSE3 },
+    { "encode_simd_avx2",         _encode_simd,              UMORSE_CODE_ALIGNED, UMORSE_SIMD_AVX2 },
+    { "encode_parallel_aligned",  _encode_parallel_aligned,  UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "encode_parallel_compact",  _encode_parallel_compact,  UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "encode_utf8_aligned",      _encode_utf8_aligned,      UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "encode_utf8_compact",      _encode_utf8_compact,      UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "decode_aligned",           _decode,                   UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "decode_compact",           _decode,                   UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "decode_dense",             _decode_dense,             UMORSE_CODE_DENSE,   UMORSE_SIMD_NONE },
+    { "render_aligned",           _render,                   UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "render_compact",           _render,                   UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "bitmap_aligned",           _bitmap,                   UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "bitmap_compact",           _bitmap,                   UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "convert_to_compact",       _convert_compact,          UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "convert_to_aligned",       _convert_aligned,          UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "output_aligned",           _output,                   UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "output_compact",           _output,                   UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+    { "output_batch_aligned",     _output_batch,             UMORSE_CODE_ALIGNED, UMORSE_SIMD_NONE },
+    { "output_batch_compact",     _output_batch,             UMORSE_CODE_COMPACT, UMORSE_SIMD_NONE },
+};
+
+static unsigned long long _now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void _fill(const corpus_t *corpus)
+{
+    srand(1);
+    size_t cnt = corpus->chars ? strlen(corpus->chars) : 0;
+    for (size_t i = 0; i < sizeof(text);) {
+        if (corpus->chars == NULL) {
+            text[i++] = (char)(rand() & 0xFF);
+            continue;
+        }
+        /* whole UTF-8 sequences, a tail too short for one is padded */
+        const char *c = corpus->chars + rand() % cnt;
+        size_t n = 1;
+        while ((*c & 0xC0) == 0x80) {
+            --c;
+        }
+        while ((c[n] & 0xC0) == 0x80) {
+            ++n;
+        }
+        if ((i + n) > sizeof(text)) {
+            text[i++] = ' ';
+            continue;
+        }
+        memcpy(text + i, c, n);
+        i += n;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int json = (argc > 1) && (strcmp(argv[1], "json") == 0);
+    const char *sep = "";
+
+    if (json) {
+        printf("[\n");
+    }
+    else {
+        printf("op,corpus,bytes,iterations,ns,mb_per_s,ns_per_char\n");
+    }
+    for (size_t c = 0; c < sizeof(corpora) / sizeof(corpora[0]); ++c) {
+        _fill(&corpora[c]);
+        for (size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); ++o) {
+            if (umorse_simd_set_level(ops[o].simd) != ops[o].simd) {
+                continue;
+            }
+            clen = umorse_encode(text, sizeof(text), code, sizeof(code), ops[o].flags);
+            if ((clen < 0) || (ops[o].fn() < 0)) {
+                fprintf(stderr, "%s failed on %s\n", ops[o].name, corpora[c].name);
+                return 1;
+            }
+            unsigned long iter = 0;
+            unsigned long long start = _now();
+            unsigned long long ns = 0;
+            do {
+                ops[o].fn();
+                ++iter;
+                ns = _now() - start;
+            } while (ns < BENCH_MIN_NS);
+            double bytes = (double)iter * sizeof(text);
+            double mbps = bytes * 1e3 / ns;
+            double nspc = ns / bytes;
+            if (json) {
+                printf("%s  {\"op\": \"%s\", \"corpus\": \"%s\", \"bytes\": %zu, "
+                       "\"iterations\": %lu, \"ns\": %llu, \"mb_per_s\": %.1f, "
+                       "\"ns_per_char\": %.3f}",
+                       sep, ops[o].name, corpora[c].name, sizeof(text),
+                       iter, ns, mbps, nspc);
+                sep = ",\n";
+            }
+            else {
+                printf("%s,%s,%zu,%lu,%llu,%.1f,%.3f\n", ops[o].name,
+                       corpora[c].name, sizeof(text), iter, ns, mbps, nspc);
+            }
+        }
+    }
+    if (json) {
+        printf("\n]\n");
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse_tests
+ * @{
+ * @file
+ * @brief       Test of uMorse compile-time encoding
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "umorse.h"
+
+static constexpr auto sos_aligned = UMORSE_CODE("SOS", UMORSE_CODE_ALIGNED);
+static constexpr auto sos_compact = UMORSE_CODE("SOS", UMORSE_CODE_COMPACT);
+static constexpr auto beacon = UMORSE_CODE("vvv de DL0ABC/b 73\n~", UMORSE_CODE_COMPACT);
+
+/* ... --- ... with gaps and final stop */
+static_assert(sos_aligned.size() == 7, "aligned SOS length");
+static_assert((sos_aligned.data[0] == 0x15) && (sos_aligned.data[1] == 0x03) &&
+              (sos_aligned.data[2] == 0x2A) && (sos_aligned.data[3] == 0x03) &&
+              (sos_aligned.data[4] == 0x15) && (sos_aligned.data[5] == 0x03) &&
+              (sos_aligned.data[6] == 0xFF), "aligned SOS code");
+static_assert(sos_compact.size() == 4, "compact SOS length");
+static_assert((sos_compact.data[0] == 0xD5) && (sos_compact.data[1] == 0xEA) &&
+              (sos_compact.data[2] == 0xD5) && (sos_compact.data[3] == 0xFF),
+              "compact SOS code");
+
+template <size_t N>
+static int _check(const umorse::code<N> &code, const char *text, uint8_t flags)
+{
+    uint8_t buf[64];
+    int ret = umorse_encode(text, strlen(text), buf, sizeof(buf), flags);
+
+    if ((ret != (int)code.size()) || (memcmp(buf, code.data, code.size()) != 0)) {
+        printf("> compile-time code of \"%s\" differs\n", text);
+        return -1;
+    }
+    return 0;
+}
+
+extern "C" int test_umorse_constexpr(void)
+{
+    printf("> Compare compile-time encoding to umorse_encode:\n");
+    if ((_check(sos_aligned, "SOS", UMORSE_CODE_ALIGNED) < 0) ||
+        (_check(sos_compact, "SOS", UMORSE_CODE_COMPACT) < 0) ||
+        (_check(beacon, "vvv de DL0ABC/b 73\n~", UMORSE_CODE_COMPACT) < 0)) {
+        return 47;
+    }
+    return 0;
+}
@@ -24,14 +24,37 @@
  * @}
  */
 
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "umorse.h"
+#include "symbols.h"
 #include "print.h"
+#include "pcm.h"
+#include "tone.h"
+#include "keydec.h"
+#include "simd.h"
+#include "parallel.h"
+#include "sched.h"
+#include "index.h"
+#include "bitmap.h"
+#include "stats.h"
+#include "ring.h"
+#include "convert.h"
+#include "utf8.h"
+#include "skim.h"
+#include "reference.h"
 
 #define CODE_LEN	(128U)
 
+#ifndef TEST_CLI
+#define TEST_CLI	"../cli/umorse"
+#endif
+
 static const umorse_out_t out = {
 	.dit = umorse_print_dit,
 	.dah = umorse_print_dah,
@@ -49,7 +72,6 @@ int test_umorse_print(void)
 	printf("> Translate text of length %lu into Morse code:\n\"%s\"\n",
 		   strlen(text), text);
 
-	memset(code, 0, CODE_LEN);
 	printf("> using aligned encoding:\n");
 	ret = umorse_encode_aligned(text, sizeof(text), code, sizeof(code));
 	if (ret < 0) {
@@ -58,7 +80,6 @@ int test_umorse_print(void)
 	umorse_output(&out, code, ret, 0x0);
 	printf("> encoded length=%d\n", ret);
 
-	memset(code, 0, CODE_LEN);
 	printf("> using compact encoding:\n");
 	ret = umorse_encode_compact(text, sizeof(text), code, sizeof(code));
 	if (ret < 0) {
@@ -70,9 +91,1663 @@ int test_umorse_print(void)
 	return 0;
 }
 
+/* normalized form of text, as expected from decoding its Morse code */
+static const char text_decoded[] = "HELLO WORLD!\nTHIS IS UMORSE.\n0123456789";
+
+static int _test_roundtrip(uint8_t flags)
+{
+	uint8_t code[CODE_LEN];
+	char dec[CODE_LEN];
+	int ret = -1;
+
+	ret = umorse_encode(text, sizeof(text), code, sizeof(code), flags);
+	if (ret < 0) {
+		return 1;
+	}
+	int clen = ret;
+	ret = umorse_decode(code, clen, dec, sizeof(dec));
+	if ((ret != (int)strlen(text_decoded)) ||
+		(memcmp(dec, text_decoded, ret) != 0)) {
+		printf("> decoding failed, got \"%.*s\"\n", ret, dec);
+		return 2;
+	}
+
+	/* rough decode throughput on the same input */
+	size_t chars = 0;
+	clock_t start = clock();
+	for (unsigned i = 0; i < 100000U; ++i) {
+		chars += umorse_decode(code, clen, dec, sizeof(dec));
+	}
+	double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+	if (secs > 0) {
+		printf("> decoded %lu chars at %.1f Mchar/s\n",
+			   chars, chars / secs / 1e6);
+	}
+	return 0;
+}
+
+int test_umorse_decode(void)
+{
+	printf("> Decode Morse code of aligned encoding:\n");
+	if (_test_roundtrip(UMORSE_CODE_ALIGNED) != 0) {
+		return 3;
+	}
+	printf("> Decode Morse code of compact encoding:\n");
+	if (_test_roundtrip(UMORSE_CODE_COMPACT) != 0) {
+		return 4;
+	}
+	return 0;
+}
+
+/* expected decoding of a single encoded input byte, 0 if it is ignored */
+static char _expected_char(int c)
+{
+	if ((c >= 'a') && (c <= 'z')) {
+		return (char)(c - 32);
+	}
+	if (((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9'))) {
+		return (char)c;
+	}
+	if ((c > 0) && strchr(".,?'!/()&:;=+-_\"@>", c)) {
+		return (char)c;
+	}
+	if ((c == ' ') || (c == '\t')) {
+		return ' ';
+	}
+	if ((c > 0) && (c < ' ')) {
+		return '\n';
+	}
+	return 0;
+}
+
+int test_umorse_encode(void)
+{
+	uint8_t code[CODE_LEN];
+	char dec[CODE_LEN];
+
+	printf("> Encode every input byte in both modes:\n");
+	for (int c = 0; c < 256; ++c) {
+		char tc = (char)c;
+		char exp = _expected_char(c);
+		for (uint8_t flags = 0; flags < 2; ++flags) {
+			int ret = umorse_encode(&tc, 1, code, sizeof(code), flags);
+			ret = umorse_decode(code, ret, dec, sizeof(dec));
+			if ((exp && ((ret != 1) || (dec[0] != exp))) || (!exp && ret)) {
+				printf("> byte 0x%02x encoded wrong in mode %u\n", c, flags);
+				return 5;
+			}
+		}
+	}
+
+	/* same code as the branchy encoder, byte by byte and for the sample */
+	uint8_t ref[CODE_LEN];
+	for (int c = 0; c <= 256; ++c) {
+		char tc = (char)c;
+		const char *t = (c < 256) ? &tc : text;
+		size_t tlen = (c < 256) ? 1 : sizeof(text);
+		for (uint8_t flags = 0; flags < 2; ++flags) {
+			int ret = umorse_encode(t, tlen, code, sizeof(code), flags);
+			int exp = umorse_encode_reference(t, tlen, ref, sizeof(ref), flags);
+			if ((ret != exp) || (memcmp(code, ref, ret) != 0)) {
+				printf("> %s differs from reference in mode %u\n",
+					   (c < 256) ? "byte" : "sample text", flags);
+				return 67;
+			}
+		}
+	}
+
+	/* encode throughput over random bytes */
+	static char bulk[1U << 16];
+	static uint8_t bulk_code[4 * sizeof(bulk)];
+	srand(1);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = (char)(rand() & 0xFF);
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		clock_t start = clock();
+		for (unsigned i = 0; i < 200U; ++i) {
+			umorse_encode(bulk, sizeof(bulk), bulk_code, sizeof(bulk_code), flags);
+		}
+		double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (secs > 0) {
+			printf("> encoded %s at %.1f MB/s\n",
+				   (flags & UMORSE_CODE_COMPACT) ? "compact" : "aligned",
+				   200.0 * sizeof(bulk) / secs / 1e6);
+		}
+	}
+	return 0;
+}
+
+int test_umorse_encoder(void)
+{
+	static char bulk[4096];
+	static uint8_t whole[4 * sizeof(bulk)];
+	static uint8_t chunked[4 * sizeof(bulk)];
+
+	printf("> Encode in chunks and compare to whole encoding:\n");
+	srand(2);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = (char)(rand() & 0xFF);
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		umorse_encoder_t enc;
+		int len = umorse_encode(bulk, sizeof(bulk), whole, sizeof(whole), flags);
+		size_t tpos = 0;
+		size_t cpos = 0;
+
+		umorse_encoder_init(&enc, flags);
+		while (tpos < sizeof(bulk)) {
+			/* small, odd sized input and output chunks */
+			size_t tlen = 1 + rand() % 13;
+			size_t clen = 1 + rand() % 7;
+			size_t used = 0;
+			if (tlen > sizeof(bulk) - tpos) {
+				tlen = sizeof(bulk) - tpos;
+			}
+			cpos += umorse_encoder_feed(&enc, bulk + tpos, tlen, &used,
+										chunked + cpos, clen);
+			tpos += used;
+		}
+		int ret = umorse_encoder_finish(&enc, chunked + cpos,
+										sizeof(chunked) - cpos);
+		if ((ret < 0) || ((int)cpos + ret != len) ||
+			(memcmp(whole, chunked, len) != 0)) {
+			printf("> chunked encoding differs in mode %u\n", flags);
+			return 6;
+		}
+	}
+	return 0;
+}
+
+/* records output events, one byte each, in the form of a batch span */
+int test_umorse_decoder(void)
+{
+	static char bulk[4096];
+	static uint8_t code[4 * sizeof(bulk)];
+	static char whole[2 * sizeof(bulk)];
+	static char chunked[2 * sizeof(bulk)];
+	const char *chars = "ETAOIN SHRDLU 0123456789\n  ";
+
+	printf("> Decode in chunks and compare to whole decoding:\n");
+	srand(6);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = chars[rand() % strlen(chars)];
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		umorse_decoder_t dec;
+		int clen = umorse_encode(bulk, sizeof(bulk), code, sizeof(code), flags);
+		int len = umorse_decode(code, clen, whole, sizeof(whole));
+		size_t cpos = 0;
+		size_t tpos = 0;
+
+		umorse_decoder_init(&dec);
+		while (cpos < (size_t)clen) {
+			/* small, odd sized input and output chunks */
+			size_t n = 1 + rand() % 7;
+			size_t tlen = UMORSE_DECODE_BYTE_MAX + rand() % 5;
+			size_t used = 0;
+			if (n > clen - cpos) {
+				n = clen - cpos;
+			}
+			int ret = umorse_decoder_feed(&dec, code + cpos, n, &used,
+										  chunked + tpos, tlen);
+			if (ret < 0) {
+				break;
+			}
+			cpos += used;
+			tpos += ret;
+		}
+		int ret = umorse_decoder_finish(&dec, chunked + tpos, sizeof(chunked) - tpos);
+		if ((len < 0) || (ret < 0) || ((int)tpos + ret != len) ||
+			(memcmp(whole, chunked, len) != 0)) {
+			printf("> chunked decoding differs in mode %u\n", flags);
+			return 25;
+		}
+	}
+	return 0;
+}
+
+typedef struct {
+	uint8_t events[4096];
+	size_t len;
+} record_t;
+
+static void _rec_dit(void *args, uint8_t flags)
+{
+	(void) flags;
+	record_t *rec = args;
+	rec->events[rec->len++] = UMORSE_DIT;
+}
+
+static void _rec_dah(void *args, uint8_t flags)
+{
+	(void) flags;
+	record_t *rec = args;
+	rec->events[rec->len++] = UMORSE_DAH;
+}
+
+static void _rec_nil(void *args, uint8_t flags)
+{
+	record_t *rec = args;
+	rec->events[rec->len++] = UMORSE_SPAN_NIL | (flags & UMORSE_MASK_COUNT);
+}
+
+static void _rec_batch(void *args, const uint8_t *span, size_t len,
+					   uint8_t flags)
+{
+	(void) flags;
+	record_t *rec = args;
+	memcpy(rec->events + rec->len, span, len);
+	rec->len += len;
+}
+
+int test_umorse_output_batch(void)
+{
+	static record_t single;
+	static record_t batch;
+	const umorse_out_t out_single = {
+		.dit = _rec_dit, .dah = _rec_dah, .nil = _rec_nil, .params = &single
+	};
+	const umorse_out_t out_batch = {
+		.params = &batch, .batch = _rec_batch
+	};
+	uint8_t code[CODE_LEN];
+
+	printf("> Output in spans and compare to single elements:\n");
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		int ret = umorse_encode(text, sizeof(text), code, sizeof(code), flags);
+		single.len = 0;
+		batch.len = 0;
+		umorse_output(&out_single, code, ret, UMORSE_FLAG_NODELAY);
+		umorse_output(&out_batch, code, ret, UMORSE_FLAG_NODELAY);
+		if ((single.len != batch.len) ||
+			(memcmp(single.events, batch.events, single.len) != 0)) {
+			printf("> batch output differs in mode %u\n", flags);
+			return 7;
+		}
+	}
+	return 0;
+}
+
+int test_umorse_timeline(void)
+{
+	static const char paris[] = "PARIS PARIS";
+	uint8_t code[CODE_LEN];
+	umorse_key_t keys[CODE_LEN];
+	umorse_timing_t timing;
+
+	printf("> Render keying timeline:\n");
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		int ret = umorse_encode(paris, sizeof(paris) - 1, code, sizeof(code), flags);
+		int klen = umorse_timeline(code, ret, NULL, 0, NULL);
+		if (umorse_timeline(code, ret, keys, klen, NULL) != klen) {
+			return 8;
+		}
+		/* a PARIS word with its word gap lasts 50 dits, the final stop 15 */
+		uint32_t units = 0;
+		for (int i = 0; i < klen; ++i) {
+			units += keys[i] & UMORSE_KEY_DURATION;
+			if ((i > 0) && !((keys[i] ^ keys[i - 1]) & UMORSE_KEY_ON)) {
+				printf("> adjacent events not merged\n");
+				return 9;
+			}
+		}
+		if (units != (50 + 43 + 15)) {
+			printf("> timeline lasts %u dits\n", (unsigned)units);
+			return 10;
+		}
+	}
+	/* 20 wpm characters at 10 wpm overall, 4.14s extra per PARIS word */
+	umorse_timing_init(&timing, 20, 10);
+	if ((timing.dit != 60000) || (timing.chr != 3 * 4140000UL / 19) ||
+		(timing.word != 7 * 4140000UL / 19)) {
+		return 11;
+	}
+	return 0;
+}
+
+int test_umorse_bitmap(void)
+{
+	static char bulk[512];
+	static uint8_t code[4 * sizeof(bulk)];
+	static umorse_key_t keys[8 * sizeof(bulk)];
+	static uint8_t exp[16 * sizeof(bulk)];
+	static uint8_t bitmap[16 * sizeof(bulk)];
+	const char *chars = "ETAOIN SHRDLU 0123456789\n  ?";
+
+	printf("> Render keying bitmap:\n");
+	srand(11);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = chars[rand() % strlen(chars)];
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		for (size_t tlen = 0; tlen <= sizeof(bulk); tlen += 1 + tlen / 3) {
+			int clen = umorse_encode(bulk, tlen, code, sizeof(code), flags);
+			int klen = umorse_timeline(code, clen, keys, sizeof(keys) / sizeof(keys[0]),
+									   NULL);
+			/* expand the timeline in dit units, one bit each */
+			size_t units = 0;
+			memset(exp, 0, sizeof(exp));
+			for (int k = 0; k < klen; ++k) {
+				for (uint32_t d = 0; d < (keys[k] & UMORSE_KEY_DURATION); ++d) {
+					if (keys[k] & UMORSE_KEY_ON) {
+						exp[units / 8] |= 1 << (units % 8);
+					}
+					++units;
+				}
+			}
+			int ret = umorse_bitmap(code, clen, NULL, 0);
+			if ((ret < 0) || ((size_t)ret != units)) {
+				printf("> bitmap of %zu chars has %d units, expected %zu\n",
+					   tlen, ret, units);
+				return 36;
+			}
+			/* exact size fits, without touching the byte after */
+			size_t blen = UMORSE_BITMAP_BYTES(units);
+			memset(bitmap, 0xAA, sizeof(bitmap));
+			if ((umorse_bitmap(code, clen, bitmap, blen) != ret) ||
+				(memcmp(bitmap, exp, blen) != 0) || (bitmap[blen] != 0xAA)) {
+				printf("> bitmap of %zu chars differs from timeline\n", tlen);
+				return 37;
+			}
+			if ((blen > 0) && (umorse_bitmap(code, clen, bitmap, blen - 1) >= 0)) {
+				return 38;
+			}
+		}
+	}
+	return 0;
+}
+
+int test_umorse_render(void)
+{
+	static record_t rec;
+	const umorse_out_t out_rec = {
+		.params = &rec, .batch = _rec_batch
+	};
+	const char *chars = "ETAOIN SHRDLU 0123456789\n  ";
+	char bulk[256];
+	uint8_t code[4 * sizeof(bulk)];
+	char exp[4 * sizeof(rec.events)];
+	char dots[4 * sizeof(rec.events)];
+
+	printf("> Render dot-dash text and compare to output:\n");
+	srand(7);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = chars[rand() % strlen(chars)];
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		int clen = umorse_encode(bulk, sizeof(bulk), code, sizeof(code), flags);
+		size_t len = 0;
+		rec.len = 0;
+		umorse_output(&out_rec, code, clen, UMORSE_FLAG_NODELAY);
+		/* glyphs of umorse_print_* */
+		for (size_t i = 0; i < rec.len; ++i) {
+			uint8_t cnt = rec.events[i] & UMORSE_MASK_COUNT;
+			if (rec.events[i] == UMORSE_DIT) {
+				exp[len++] = '.';
+			}
+			else if (rec.events[i] == UMORSE_DAH) {
+				exp[len++] = '_';
+			}
+			else if (cnt > 7) {
+				exp[len++] = '\n';
+			}
+			else if (cnt > 3) {
+				memcpy(exp + len, " / ", 3);
+				len += 3;
+			}
+			else if (cnt > 1) {
+				exp[len++] = ' ';
+			}
+		}
+		int ret = umorse_render(code, clen, dots, sizeof(dots));
+		if ((ret != (int)len) || (memcmp(exp, dots, len) != 0) ||
+			(umorse_render(code, clen, NULL, 0) != ret) ||
+			(umorse_render(code, clen, dots, ret - 1) >= 0) ||
+			(umorse_render(code, clen, dots, ret) != ret)) {
+			printf("> rendering differs in mode %u\n", flags);
+			return 26;
+		}
+		/* incremental, in small chunks */
+		umorse_renderer_t r;
+		size_t cpos = 0;
+		size_t tpos = 0;
+		umorse_renderer_init(&r);
+		while (cpos < (size_t)clen) {
+			size_t used = 0;
+			size_t n = 1 + rand() % 5;
+			n = (n < clen - cpos) ? n : (clen - cpos);
+			tpos += umorse_renderer_feed(&r, code + cpos, n, &used, dots + tpos,
+										 UMORSE_RENDER_BYTE_MAX + rand() % 9);
+			cpos += used;
+		}
+		tpos += umorse_renderer_finish(&r, dots + tpos, sizeof(dots) - tpos);
+		if ((tpos != len) || (memcmp(exp, dots, len) != 0)) {
+			printf("> chunked rendering differs in mode %u\n", flags);
+			return 27;
+		}
+	}
+	return 0;
+}
+
+int test_umorse_index(void)
+{
+	static char bulk[4096];
+	static uint8_t code[4 * sizeof(bulk)];
+	static char whole[2 * sizeof(bulk)];
+	static char part[2 * sizeof(bulk)];
+	static size_t starts[sizeof(bulk)];
+	static size_t pos[sizeof(bulk) / 16];
+	static record_t all;
+	static record_t rec;
+	const umorse_out_t out_all = { .params = &all, .batch = _rec_batch };
+	const umorse_out_t out_rec = { .params = &rec, .batch = _rec_batch };
+	const char *chars = "ETAOIN SHRDLU 0123456789\n  ";
+
+	printf("> Seek chars with a sparse index:\n");
+	srand(8);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = chars[rand() % strlen(chars)];
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		umorse_index_t idx;
+		int clen = umorse_encode(bulk, sizeof(bulk), code, sizeof(code), flags);
+		int len = umorse_decode(code, clen, whole, sizeof(whole));
+		size_t cnt = 0;
+		for (int i = 0; i < len; ++i) {
+			if ((whole[i] != ' ') && (whole[i] != '\n')) {
+				starts[cnt++] = i;
+			}
+		}
+		/* too few entries, the partial index only covers their chars */
+		int need = umorse_index_build(&idx, pos, 4, 16, code, clen);
+		if ((need != (int)((cnt + 15) / 16)) || (idx.chars != 4 * 16) ||
+			(umorse_index_seek(&idx, code, clen, 4 * 16) != UMORSE_INDEX_END) ||
+			(umorse_index_seek(&idx, code, clen, cnt - 1) != UMORSE_INDEX_END) ||
+			(umorse_index_build(&idx, pos, sizeof(pos) / sizeof(pos[0]), 16,
+								code, clen) != need) ||
+			(idx.chars != cnt)) {
+			printf("> index build failed in mode %u\n", flags);
+			return 28;
+		}
+		for (size_t chr = 0; chr < cnt; chr += 7) {
+			size_t p = umorse_index_seek(&idx, code, clen, chr);
+			int ret = umorse_decode_at(code, clen, p, part, sizeof(part));
+			if ((p == UMORSE_INDEX_END) || (ret != len - (int)starts[chr]) ||
+				(memcmp(part, whole + starts[chr], ret) != 0)) {
+				printf("> seek to char %zu failed in mode %u\n", chr, flags);
+				return 29;
+			}
+		}
+		if (umorse_index_seek(&idx, code, clen, cnt) != UMORSE_INDEX_END) {
+			return 30;
+		}
+		/* output from a char matches the tail of the whole output, with
+		 * input short enough to record all of it */
+		clen = umorse_encode(bulk, 256, code, sizeof(code), flags);
+		umorse_index_build(&idx, pos, sizeof(pos) / sizeof(pos[0]), 16, code, clen);
+		all.len = 0;
+		umorse_output(&out_all, code, clen, UMORSE_FLAG_NODELAY);
+		for (size_t chr = 0; chr < idx.chars; chr += 5) {
+			rec.len = 0;
+			umorse_output_at(&out_rec, code, clen,
+							 umorse_index_seek(&idx, code, clen, chr),
+							 UMORSE_FLAG_NODELAY);
+			if ((rec.len > all.len) ||
+				(memcmp(rec.events, all.events + all.len - rec.len, rec.len) != 0)) {
+				printf("> output from char %zu differs in mode %u\n", chr, flags);
+				return 31;
+			}
+		}
+	}
+	return 0;
+}
+
+int test_umorse_dense(void)
+{
+	static char bulk[1024];
+	static uint8_t compact[4 * sizeof(bulk)];
+	static uint8_t dense[4 * sizeof(bulk)];
+	static uint8_t chunked[4 * sizeof(bulk)];
+	static char exp[2 * sizeof(bulk)];
+	static char dec[2 * sizeof(bulk)];
+	static record_t single;
+	static record_t batch;
+	const umorse_out_t out_single = {
+		.dit = _rec_dit, .dah = _rec_dah, .nil = _rec_nil, .params = &single
+	};
+	const umorse_out_t out_batch = { .params = &batch, .batch = _rec_batch };
+	const char *chars = "ETAOIN SHRDLU 0123456789\n  ?";
+
+	printf("> Encode in dense mode and compare to compact mode:\n");
+	srand(9);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = chars[rand() % strlen(chars)];
+	}
+	for (size_t tlen = 0; tlen <= sizeof(bulk); tlen += 1 + tlen / 4) {
+		int clen = umorse_encode_compact(bulk, tlen, compact, sizeof(compact));
+		int dlen = umorse_encode_dense(bulk, tlen, dense, sizeof(dense));
+		int len = umorse_decode(compact, clen, exp, sizeof(exp));
+		int ret = umorse_decode_dense(dense, dlen, dec, sizeof(dec));
+		if ((dlen < 0) || ((size_t)dlen != umorse_encode_len(bulk, tlen, UMORSE_CODE_DENSE)) ||
+			(ret != len) || (memcmp(exp, dec, len) != 0)) {
+			printf("> dense decoding differs for %zu chars\n", tlen);
+			return 32;
+		}
+		/* output of both modes, for the beginning */
+		if (tlen <= 256) {
+			single.len = 0;
+			batch.len = 0;
+			umorse_output(&out_single, compact, clen, UMORSE_FLAG_NODELAY);
+			umorse_output(&out_batch, dense, dlen, UMORSE_FLAG_NODELAY | UMORSE_FLAG_DENSE);
+			if ((single.len != batch.len) ||
+				(memcmp(single.events, batch.events, single.len) != 0)) {
+				printf("> dense output differs for %zu chars\n", tlen);
+				return 33;
+			}
+			single.len = 0;
+			umorse_output(&out_single, dense, dlen, UMORSE_FLAG_NODELAY | UMORSE_FLAG_DENSE);
+			if ((single.len != batch.len) ||
+				(memcmp(single.events, batch.events, single.len) != 0)) {
+				return 33;
+			}
+		}
+	}
+	/* in chunks, and truncated at a char */
+	umorse_encoder_t enc;
+	size_t tpos = 0;
+	size_t cpos = 0;
+	int dlen = umorse_encode_dense(bulk, sizeof(bulk), dense, sizeof(dense));
+	umorse_encoder_init(&enc, UMORSE_CODE_DENSE);
+	while (tpos < sizeof(bulk)) {
+		size_t used = 0;
+		size_t tlen = 1 + rand() % 13;
+		tlen = (tlen < sizeof(bulk) - tpos) ? tlen : sizeof(bulk) - tpos;
+		cpos += umorse_encoder_feed(&enc, bulk + tpos, tlen, &used, chunked + cpos,
+									1 + rand() % 3);
+		tpos += used;
+	}
+	cpos += umorse_encoder_finish(&enc, chunked + cpos, sizeof(chunked) - cpos);
+	if ((cpos != (size_t)dlen) || (memcmp(dense, chunked, dlen) != 0)) {
+		printf("> chunked dense encoding differs\n");
+		return 34;
+	}
+	for (size_t clen = UMORSE_THRESHOLD_DENSE; clen < 64; ++clen) {
+		int ret = umorse_encode_dense(bulk, sizeof(bulk), dense, clen);
+		if ((ret < 0) || ((size_t)ret > clen) ||
+			(umorse_decode_dense(dense, ret, dec, sizeof(dec)) < 0)) {
+			printf("> truncated dense encoding failed for %zu bytes\n", clen);
+			return 35;
+		}
+	}
+	int clen = umorse_encode_compact(bulk, sizeof(bulk), compact, sizeof(compact));
+	printf("> %zu chars in %d bytes compact, %d bytes dense\n",
+		   sizeof(bulk), clen, dlen);
+	return 0;
+}
+
+int test_umorse_stats(void)
+{
+	static const char text[] = "SOS ~ SOS#";
+	static const uint8_t unknown[] = { 0xAA, 0x03, 0xFF };
+	static umorse_stats_t stats;
+	static record_t rec;
+	const umorse_out_t out_rec = {
+		.dit = _rec_dit, .dah = _rec_dah, .nil = _rec_nil, .params = &rec
+	};
+	uint8_t code[CODE_LEN];
+	char dec[CODE_LEN];
+
+	printf("> Instrumentation counters:\n");
+	umorse_stats_reset();
+	int ret = umorse_encode(text, sizeof(text) - 1, code, sizeof(code), UMORSE_CODE_ALIGNED);
+	umorse_encode(text, sizeof(text) - 1, code, 4, UMORSE_CODE_ALIGNED);
+	umorse_decode(code, ret, dec, 2);
+	umorse_decode(unknown, sizeof(unknown), dec, sizeof(dec));
+	rec.len = 0;
+	umorse_output(&out_rec, code, ret, UMORSE_FLAG_NODELAY);
+	if (umorse_stats_snapshot(&stats) < 0) {
+		/* built without UMORSE_STATS, all zero */
+		for (size_t i = 0; i < sizeof(stats); ++i) {
+			if (((uint8_t *)&stats)[i] != 0) {
+				return 39;
+			}
+		}
+		return 0;
+	}
+	/* 2 of 10 bytes ignored, the second call stops after the first S */
+	if ((stats.encode_calls != 2) || (stats.encode_bytes != 11) ||
+		(stats.encode_skipped != 2) || (stats.encode_truncated != 1)) {
+		printf("> encode counters %lu, %lu, %lu, %lu\n",
+			   (unsigned long)stats.encode_calls, (unsigned long)stats.encode_bytes,
+			   (unsigned long)stats.encode_skipped,
+			   (unsigned long)stats.encode_truncated);
+		return 40;
+	}
+	if ((stats.decode_calls != 2) || (stats.decode_unknown != 1) ||
+		(stats.decode_truncated != 1)) {
+		return 41;
+	}
+	/* every recorded event went through a timed callback */
+	uint64_t calls = 0;
+	for (unsigned cb = 0; cb < UMORSE_STATS_CB_NUMOF; ++cb) {
+		uint64_t sum = 0;
+		for (unsigned k = 0; k < UMORSE_STATS_BUCKETS; ++k) {
+			sum += stats.latency[cb][k];
+		}
+		if (sum != stats.callbacks[cb]) {
+			return 42;
+		}
+		calls += sum;
+	}
+	if ((stats.output_calls != 1) || (calls != rec.len) ||
+		(stats.output_elements != rec.len) ||
+		(stats.callbacks[UMORSE_STATS_BATCH] != 0)) {
+		return 42;
+	}
+	/* batch and scheduled output count runs and elements alike */
+	const umorse_out_t out_batch = { .params = &rec, .batch = _rec_batch };
+	umorse_sched_t sched;
+	umorse_job_t job;
+	umorse_job_t *heap[1];
+	size_t len = rec.len;
+	umorse_output(&out_batch, code, ret, UMORSE_FLAG_NODELAY);
+	umorse_sched_init(&sched, heap, 1);
+	umorse_job_init(&job, &out_rec, code, ret, 1, 0);
+	umorse_sched_add(&sched, &job, 0);
+	umorse_sched_run(&sched, UINT64_MAX - 1);
+	umorse_stats_snapshot(&stats);
+	if ((stats.output_calls != 3) || (stats.output_elements != 3 * len)) {
+		printf("> output counters %lu, %lu\n", (unsigned long)stats.output_calls,
+			   (unsigned long)stats.output_elements);
+		return 42;
+	}
+	umorse_stats_reset();
+	umorse_stats_snapshot(&stats);
+	return (stats.encode_calls == 0) ? 0 : 39;
+}
+
+static const char ring_text[] =
+	"CQ CQ CQ DE UMORSE UMORSE K\n"
+	"THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG 0123456789  ";
+
+static void *_ring_producer(void *arg)
+{
+	umorse_ring_t *ring = arg;
+
+	for (size_t tpos = 0; tpos < sizeof(ring_text) - 1; tpos += 7) {
+		size_t tlen = sizeof(ring_text) - 1 - tpos;
+		tlen = (tlen < 7) ? tlen : 7;
+		if (umorse_ring_write(ring, ring_text + tpos, tlen, 1) != (int)tlen) {
+			return ring;
+		}
+	}
+	umorse_ring_close(ring, 1);
+	return NULL;
+}
+
+int test_umorse_ring(void)
+{
+	static uint8_t code[4 * sizeof(ring_text)];
+	static record_t exp;
+	static record_t rec;
+	const umorse_out_t out_exp = {
+		.dit = _rec_dit, .dah = _rec_dah, .nil = _rec_nil, .params = &exp
+	};
+	const umorse_out_t out_rec = {
+		.dit = _rec_dit, .dah = _rec_dah, .nil = _rec_nil, .params = &rec
+	};
+	const umorse_out_t out_batch = { .params = &rec, .batch = _rec_batch };
+	uint8_t buf[16];
+	umorse_ring_t ring;
+
+	printf("> Stream through a ring between encoder and output:\n");
+	if ((umorse_ring_init(&ring, buf, 12, UMORSE_CODE_ALIGNED) == 0) ||
+		(umorse_ring_init(&ring, buf, 16, UMORSE_CODE_DENSE) == 0)) {
+		return 43;
+	}
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		int clen = umorse_encode(ring_text, sizeof(ring_text) - 1, code, sizeof(code), flags);
+		exp.len = 0;
+		umorse_output(&out_exp, code, clen, UMORSE_FLAG_NODELAY);
+
+		/* one thread, the producer stops at a full ring */
+		size_t tpos = 0;
+		rec.len = 0;
+		umorse_ring_init(&ring, buf, 8, flags);
+		while (tpos < sizeof(ring_text) - 1) {
+			tpos += umorse_ring_write(&ring, ring_text + tpos,
+									  sizeof(ring_text) - 1 - tpos, 0);
+			umorse_ring_output(&ring, &out_batch, UMORSE_FLAG_NODELAY, 0);
+		}
+		while (umorse_ring_close(&ring, 0) < 0) {
+			umorse_ring_output(&ring, &out_batch, UMORSE_FLAG_NODELAY, 0);
+		}
+		while (umorse_ring_output(&ring, &out_batch, UMORSE_FLAG_NODELAY, 0) > 0) {}
+		umorse_ring_output(&ring, &out_batch, UMORSE_FLAG_NODELAY, 0);
+		if ((rec.len != exp.len) || (memcmp(rec.events, exp.events, exp.len) != 0)) {
+			printf("> ring output differs from umorse_output\n");
+			return 44;
+		}
+
+		/* producer thread, both ends waiting on each other */
+		pthread_t thread;
+		void *res;
+		rec.len = 0;
+		umorse_ring_init(&ring, buf, sizeof(buf), flags);
+		if (pthread_create(&thread, NULL, _ring_producer, &ring) != 0) {
+			return 45;
+		}
+		while (umorse_ring_output(&ring, &out_rec, UMORSE_FLAG_NODELAY, 1) > 0) {}
+		pthread_join(thread, &res);
+		if ((res != NULL) || (rec.len != exp.len) ||
+			(memcmp(rec.events, exp.events, exp.len) != 0)) {
+			printf("> threaded ring output differs from umorse_output\n");
+			return 46;
+		}
+	}
+	return 0;
+}
+
+int test_umorse_convert(void)
+{
+	static char bulk[4096];
+	static uint8_t aligned[4 * sizeof(bulk)];
+	static uint8_t compact[4 * sizeof(bulk)];
+	static uint8_t conv[4 * sizeof(bulk)];
+	static char exp[2 * sizeof(bulk)];
+	static char dec[2 * sizeof(bulk)];
+	const char *text = "The quick brown fox jumps over the lazy dog 1234567890.\n";
+
+	printf("> Convert between aligned and compact code:\n");
+	/* canonical text converts back to the same bytes */
+	int alen = umorse_encode_aligned(text_decoded, sizeof(text_decoded) - 1,
+									 aligned, sizeof(aligned));
+	int clen = umorse_encode_compact(text_decoded, sizeof(text_decoded) - 1,
+									 compact, sizeof(compact));
+	if ((umorse_convert(compact, clen, conv, sizeof(conv), UMORSE_CODE_ALIGNED) != alen) ||
+		(memcmp(conv, aligned, alen) != 0)) {
+		return 48;
+	}
+	srand(13);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = (rand() & 3) ? text[rand() % strlen(text)] : (char)(rand() & 0xFF);
+	}
+	unsigned top = umorse_simd_level();
+	for (unsigned level = UMORSE_SIMD_NONE; level <= top; level += top) {
+		umorse_simd_set_level(level);
+		for (size_t tlen = 0; tlen <= sizeof(bulk); tlen += 1 + tlen / 2) {
+			alen = umorse_encode_aligned(bulk, tlen, aligned, sizeof(aligned));
+			clen = umorse_encode_compact(bulk, tlen, compact, sizeof(compact));
+			int ret = umorse_convert_compact(aligned, alen, NULL, 0);
+			if ((ret != clen) ||
+				(umorse_convert_compact(aligned, alen, conv, clen) != clen) ||
+				(memcmp(conv, compact, clen) != 0) ||
+				(umorse_convert_compact(aligned, alen, conv, clen - 1) >= 0)) {
+				printf("> level %u, %zu chars to compact differ\n", level, tlen);
+				return 49;
+			}
+			/* back to aligned, runs of gaps may be reordered */
+			ret = umorse_convert_aligned(compact, clen, NULL, 0);
+			if ((ret < 0) || (umorse_convert_aligned(compact, clen, conv, ret) != ret) ||
+				(umorse_convert_aligned(compact, clen, conv, ret - 1) >= 0)) {
+				return 50;
+			}
+			int len = umorse_decode(aligned, alen, exp, sizeof(exp));
+			if ((umorse_decode(conv, ret, dec, sizeof(dec)) != len) ||
+				(memcmp(exp, dec, len) != 0)) {
+				printf("> %zu chars to aligned decode differently\n", tlen);
+				return 51;
+			}
+		}
+	}
+	umorse_simd_set_level(top);
+	return 0;
+}
+
+int test_umorse_symbols(void)
+{
+	static const struct {
+		char c;
+		uint16_t cw;
+	} list[] = {
+#define SYMBOL(c, cw)	{ (c), (cw) },
+		UMORSE_SYMBOLS(SYMBOL)
+#undef SYMBOL
+	};
+	unsigned found = 0;
+
+	printf("> Decode every code word of the symbol list:\n");
+	for (size_t i = 0; i < sizeof(list) / sizeof(list[0]); ++i) {
+		if (umorse_decode_char(list[i].cw) != list[i].c) {
+			printf("> symbol %c, cw=0x%04x decodes to %c\n", list[i].c,
+				   list[i].cw, umorse_decode_char(list[i].cw));
+			return 52;
+		}
+	}
+	/* no other code word must hit the hash */
+	for (unsigned cw = 0; cw < (1U << (UMORSE_DECODE_MAX * UMORSE_SHIFT)); ++cw) {
+		if (umorse_decode_char((uint16_t)cw) != 0) {
+			++found;
+		}
+	}
+	if (found != sizeof(list) / sizeof(list[0])) {
+		printf("> %u code words decode, expected %u\n", found,
+			   (unsigned)(sizeof(list) / sizeof(list[0])));
+		return 53;
+	}
+	return 0;
+}
+
+/* encodes UTF-8 text and compares with the same code of ASCII text */
+static int _test_utf8(const char *utf8, const char *ascii, uint8_t flags,
+					  uint8_t alphabets)
+{
+	uint8_t code[64];
+	uint8_t expected[64];
+
+	int len = umorse_utf8_encode(utf8, strlen(utf8), code, sizeof(code),
+								 flags, alphabets);
+	int exp = umorse_encode(ascii, strlen(ascii), expected, sizeof(expected),
+							flags);
+	if ((len != exp) || (memcmp(code, expected, len) != 0)) {
+		printf("> \"%s\" differs from \"%s\", len=%d, expected %d\n",
+			   utf8, ascii, len, exp);
+		return 1;
+	}
+	return 0;
+}
+
+int test_umorse_utf8(void)
+{
+	static const uint8_t flags[] = {
+		UMORSE_CODE_ALIGNED, UMORSE_CODE_COMPACT, UMORSE_CODE_DENSE
+	};
+	uint8_t code[64];
+	char dec[64];
+	uint16_t mark;
+
+	printf("> Encode UTF-8 text of several alphabets:\n");
+	for (size_t f = 0; f < sizeof(flags); ++f) {
+		/* ASCII as is, Cyrillic and Greek share code words with Latin */
+		if (_test_utf8("Hello World!\n", "Hello World!\n", flags[f], 0) ||
+			_test_utf8("СОС сос", "SOS SOS", flags[f], UMORSE_ALPHABET_ALL) ||
+			_test_utf8("ΣΟΣ σος", "SOS SOS", flags[f], UMORSE_ALPHABET_GREEK) ||
+			_test_utf8("СОС ΣΟΣ", " SOS", flags[f], UMORSE_ALPHABET_GREEK)) {
+			return 54;
+		}
+		/* ga is ka and dakuten, ideographic space is a word gap */
+		if (_test_utf8("ガ\xe3\x80\x80カ", "LI L", flags[f], UMORSE_ALPHABET_WABUN) ||
+			_test_utf8("が", "LI", flags[f], UMORSE_ALPHABET_WABUN)) {
+			return 55;
+		}
+		/* overlong, stray, truncated, surrogate and out of range sequences */
+		if (_test_utf8("\xc0\xafS\x80\xbfO\xe2\x82S\xed\xa0\x80 \xf4\x90\x80\x80\xff",
+					   "SOS ", flags[f], UMORSE_ALPHABET_ALL)) {
+			return 56;
+		}
+	}
+	if ((umorse_utf8_lookup(0x30D1, UMORSE_ALPHABET_WABUN, &mark) !=
+		 umorse_utf8_lookup(0x30CF, UMORSE_ALPHABET_WABUN, NULL)) ||
+		(mark != umorse_utf8_lookup(0x309C, UMORSE_ALPHABET_WABUN, NULL)) ||
+		(umorse_utf8_lookup(0x30D1, UMORSE_ALPHABET_CYRILLIC, NULL) != UMORSE_SKIP)) {
+		return 57;
+	}
+	/* truncation keeps whole characters, a kana with its sign */
+	int len = umorse_utf8_encode("ガガ", 6, code, 6, UMORSE_CODE_ALIGNED,
+								 UMORSE_ALPHABET_WABUN);
+	if ((len != 5) ||
+		(umorse_decode(code, len, dec, sizeof(dec)) != 2) ||
+		(memcmp(dec, "LI", 2) != 0)) {
+		printf("> truncated kana, len=%d\n", len);
+		return 58;
+	}
+	return 0;
+}
+
+int test_umorse_constexpr(void);
+
+typedef struct {
+	size_t samples;
+	int16_t peak;
+} pcm_stats_t;
+
+static void _pcm_count(void *arg, const int16_t *samples, size_t len)
+{
+	pcm_stats_t *stats = arg;
+	stats->samples += len;
+	for (size_t i = 0; i < len; ++i) {
+		if (samples[i] > stats->peak) {
+			stats->peak = samples[i];
+		}
+	}
+}
+
+int test_umorse_pcm(void)
+{
+	static int16_t buf[5 * 8000 * 60 / 1000];
+	static record_t rec;
+	const umorse_out_t out_rec = {
+		.params = &rec, .batch = _rec_batch
+	};
+	pcm_stats_t stats = { 0, 0 };
+	umorse_pcm_t pcm;
+	const umorse_out_t out_pcm = {
+		.dit = umorse_pcm_dit, .dah = umorse_pcm_dah, .nil = umorse_pcm_nil,
+		.params = &pcm
+	};
+	uint8_t code[CODE_LEN];
+
+	printf("> Render PCM audio:\n");
+	if (umorse_pcm_init(&pcm, buf, sizeof(buf) / sizeof(buf[0]), 8000, 700, 60,
+						_pcm_count, &stats) != 0) {
+		return 12;
+	}
+	/* click free envelope starts and ends at zero */
+	if ((pcm.dit[0] != 0) || (pcm.dah[3 * pcm.dit_len - 1] != 0)) {
+		return 13;
+	}
+	int ret = umorse_encode(text, sizeof(text), code, sizeof(code),
+							UMORSE_CODE_COMPACT);
+	rec.len = 0;
+	umorse_output(&out_rec, code, ret, UMORSE_FLAG_NODELAY);
+	umorse_output(&out_pcm, code, ret, UMORSE_FLAG_NODELAY);
+	size_t units = 0;
+	for (size_t i = 0; i < rec.len; ++i) {
+		units += (rec.events[i] == UMORSE_DAH) ? 3
+			   : (rec.events[i] & UMORSE_MASK_COUNT);
+	}
+	if ((stats.samples != units * pcm.dit_len) ||
+		(stats.peak > UMORSE_PCM_AMPLITUDE) ||
+		(stats.peak < UMORSE_PCM_AMPLITUDE * 9 / 10)) {
+		printf("> got %lu samples, peak %d\n", stats.samples, stats.peak);
+		return 14;
+	}
+	return 0;
+}
+
+#define WAV_RATE	(48000U)
+#define WAV_DIT_MS	(40U)
+
+typedef struct {
+	uint8_t data[UMORSE_PCM_WAV_HEADER_LEN + (4U << 20)];
+	size_t len;
+} wav_t;
+
+static void _wav_write(void *arg, const int16_t *samples, size_t len)
+{
+	wav_t *wav = arg;
+	memcpy(wav->data + wav->len, samples, len * sizeof(int16_t));
+	wav->len += len * sizeof(int16_t);
+}
+
+int test_umorse_tone(void)
+{
+	static const char expected[] = "HELLO WORLD! THIS IS UMORSE. 0123456789 ";
+	static int16_t buf[5 * WAV_RATE * WAV_DIT_MS / 1000];
+	static wav_t wav;
+	umorse_pcm_t pcm;
+	const umorse_out_t out_pcm = {
+		.dit = umorse_pcm_dit, .dah = umorse_pcm_dah, .nil = umorse_pcm_nil,
+		.params = &pcm
+	};
+	uint8_t code[CODE_LEN];
+	char dec[CODE_LEN];
+
+	printf("> Decode synthetic WAV audio:\n");
+	/* synthesize a WAV file in memory, 700 Hz tone at 30 wpm */
+	umorse_pcm_init(&pcm, buf, sizeof(buf) / sizeof(buf[0]), WAV_RATE, 700,
+					WAV_DIT_MS, _wav_write, &wav);
+	wav.len = UMORSE_PCM_WAV_HEADER_LEN;
+	int ret = umorse_encode(text, sizeof(text), code, sizeof(code),
+							UMORSE_CODE_COMPACT);
+	umorse_output(&out_pcm, code, ret, UMORSE_FLAG_NODELAY);
+	size_t samples = (wav.len - UMORSE_PCM_WAV_HEADER_LEN) / sizeof(int16_t);
+	umorse_pcm_wav_header(wav.data, WAV_RATE, samples);
+
+	/* decode in chunks of 1024 samples, like an audio callback */
+	const int16_t *pcm_data = (const int16_t *)(wav.data + UMORSE_PCM_WAV_HEADER_LEN);
+	size_t runs = 0;
+	size_t tpos = 0;
+	clock_t start = clock();
+	do {
+		umorse_tone_t tone;
+		umorse_tone_init(&tone, WAV_RATE, 700, WAV_DIT_MS);
+		tpos = 0;
+		for (size_t i = 0; i < samples; ) {
+			size_t used = 0;
+			size_t len = (samples - i < 1024) ? (samples - i) : 1024;
+			tpos += umorse_tone_process(&tone, pcm_data + i, len, &used,
+										dec + tpos, sizeof(dec) - tpos);
+			/* nothing consumed once the text buffer is full */
+			if (used == 0) {
+				printf("> decoding overflows, got \"%.*s\"\n", (int)tpos, dec);
+				return 63;
+			}
+			i += used;
+		}
+		++runs;
+	} while ((clock() - start) < CLOCKS_PER_SEC / 2);
+	double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	if ((tpos != strlen(expected)) || (memcmp(dec, expected, tpos) != 0)) {
+		printf("> decoding failed, got \"%.*s\"\n", (int)tpos, dec);
+		return 15;
+	}
+	printf("> decoded %.1f s of %u Hz audio at %.0fx real time\n",
+		   (double)samples / WAV_RATE, WAV_RATE,
+		   runs * ((double)samples / WAV_RATE) / secs);
+
+	/* hours of silence saturate, they do not turn into a key down */
+	static const int16_t silence[WAV_RATE / 100];
+	umorse_tone_t tone;
+	umorse_tone_init(&tone, WAV_RATE, 700, WAV_DIT_MS);
+	tone.dur = UMORSE_KEY_DURATION - 1;
+	umorse_tone_process(&tone, silence, sizeof(silence) / sizeof(silence[0]), NULL,
+						dec, sizeof(dec));
+	if ((tone.dur != UMORSE_KEY_DURATION) || tone.on) {
+		printf("> long silence wraps to %lu\n", (unsigned long)tone.dur);
+		return 66;
+	}
+	return 0;
+}
+
+#define SKIM_RATE		(16000U)
+#define SKIM_SIGNALS	(56U)
+#define SKIM_LEN		(14U * SKIM_RATE)
+#define SKIM_FREQ(i)	(400U + 100U * (i))
+
+typedef struct {
+	int32_t *mix;		/* sum of all signals */
+	size_t pos;			/* next sample of this signal */
+} skim_signal_t;
+
+static void _skim_write(void *arg, const int16_t *samples, size_t len)
+{
+	skim_signal_t *sig = arg;
+
+	for (size_t i = 0; (i < len) && (sig->pos < SKIM_LEN); ++i) {
+		/* scale down, such that all signals add up without clipping */
+		sig->mix[sig->pos++] += samples[i] / 64;
+	}
+}
+
+/* bin nearest to the frequency of a signal */
+static unsigned _skim_bin(unsigned i)
+{
+	return (SKIM_FREQ(i) * UMORSE_SKIM_FFT_LEN + SKIM_RATE / 2) / SKIM_RATE;
+}
+
+int test_umorse_skim(void)
+{
+	static int32_t mix[SKIM_LEN];
+	static int16_t pcm_buf[SKIM_LEN];
+	static int16_t buf[5 * SKIM_RATE * 80 / 1000];
+	static char texts[SKIM_SIGNALS][128];
+	static size_t tlens[SKIM_SIGNALS];
+	static umorse_skim_t skim;
+	char expected[SKIM_SIGNALS][16];
+	uint32_t seed = 1;
+	unsigned decoded = 0;
+	int active = 0;
+
+	printf("> Skim %u signals in one PCM stream:\n", SKIM_SIGNALS);
+	/* 100 Hz apart from 400 Hz, at 15 to 30 wpm and staggered starts */
+	for (unsigned i = 0; i < SKIM_SIGNALS; ++i) {
+		uint8_t code[64];
+		umorse_pcm_t pcm;
+		skim_signal_t sig = { mix, (i * 37 * SKIM_RATE) / 1000 };
+		const umorse_out_t out_pcm = {
+			.dit = umorse_pcm_dit, .dah = umorse_pcm_dah, .nil = umorse_pcm_nil,
+			.params = &pcm
+		};
+		snprintf(expected[i], sizeof(expected[i]), "CQ DE D%c%u%c%c K",
+				 'A' + i % 26, i % 10, 'A' + (i * 7) % 26, 'A' + (i * 11) % 26);
+		umorse_pcm_init(&pcm, buf, sizeof(buf) / sizeof(buf[0]), SKIM_RATE,
+						SKIM_FREQ(i), 40 + 10 * (i % 5), _skim_write, &sig);
+		int clen = umorse_encode(expected[i], strlen(expected[i]), code,
+								 sizeof(code), UMORSE_CODE_COMPACT);
+		umorse_output(&out_pcm, code, clen, UMORSE_FLAG_NODELAY);
+	}
+	for (size_t i = 0; i < SKIM_LEN; ++i) {
+		/* white noise of +-1000 */
+		seed = seed * 1103515245U + 12345U;
+		int32_t v = mix[i] + (int32_t)((seed >> 16) % 2001) - 1000;
+		pcm_buf[i] = (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+	}
+
+	/* decode in chunks of 100 ms, like an audio callback */
+	if (umorse_skim_init(&skim, SKIM_RATE, 60, 0) != 0) {
+		return 59;
+	}
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (size_t i = 0; i < SKIM_LEN; i += SKIM_RATE / 10) {
+		int ret = umorse_skim_process(&skim, pcm_buf + i, SKIM_RATE / 10);
+		active = (ret > active) ? ret : active;
+		/* follow each signal, it may move to a neighbouring bin */
+		for (unsigned s = 0; s < SKIM_SIGNALS; ++s) {
+			unsigned k = _skim_bin(s);
+			for (unsigned j = k - 1; j <= k + 1; ++j) {
+				tlens[s] += umorse_skim_read(&skim, j, texts[s] + tlens[s],
+											 sizeof(texts[s]) - 1 - tlens[s]);
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	umorse_skim_close(&skim);
+	double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	for (unsigned i = 0; i < SKIM_SIGNALS; ++i) {
+		if (strstr(texts[i], expected[i]) != NULL) {
+			++decoded;
+		}
+		else {
+			printf("> %u Hz: expected \"%s\", got \"%s\"\n",
+				   SKIM_FREQ(i), expected[i], texts[i]);
+		}
+	}
+	printf("> decoded %u of %u signals, up to %d active bins, at %.0fx real time\n",
+		   decoded, SKIM_SIGNALS, active, ((double)SKIM_LEN / SKIM_RATE) / secs);
+	if (decoded != SKIM_SIGNALS) {
+		return 60;
+	}
+	return 0;
+}
+
+int test_umorse_keydec(void)
+{
+	static const char expected[] = "HELLO WORLD! THIS IS UMORSE. 0123456789 ";
+	uint8_t code[CODE_LEN];
+	umorse_key_t keys[4 * CODE_LEN];
+	umorse_timing_t timing;
+	umorse_keydec_t dec;
+	char out[CODE_LEN];
+	size_t tpos = 0;
+
+	printf("> Decode keying events with drift and jitter:\n");
+	int ret = umorse_encode(text, sizeof(text), code, sizeof(code),
+							UMORSE_CODE_ALIGNED);
+	umorse_timing_init(&timing, 15, 0);
+	int klen = umorse_timeline(code, ret, keys, sizeof(keys) / sizeof(keys[0]),
+							   &timing);
+	/* start at 15 wpm and end at 30 wpm, the decoder expects 10 wpm */
+	srand(3);
+	umorse_keydec_init(&dec, timing.dit * 3 / 2);
+	for (int i = 0; i < klen; ++i) {
+		uint32_t dur = keys[i] & UMORSE_KEY_DURATION;
+		uint32_t jitter = 85 + rand() % 31;
+		dur = (uint32_t)((uint64_t)dur * jitter * (2 * klen - i)
+						 / (100 * 2 * (uint64_t)klen));
+		if (!(keys[i] & UMORSE_KEY_ON)) {
+			/* half way through a key up, the decoder may already emit */
+			ret = umorse_keydec_idle(&dec, dur / 2, out + tpos, sizeof(out) - tpos);
+			tpos += (ret > 0) ? ret : 0;
+		}
+		ret = umorse_keydec_put(&dec, (keys[i] & UMORSE_KEY_ON) | dur,
+								out + tpos, sizeof(out) - tpos);
+		tpos += (ret > 0) ? ret : 0;
+	}
+	if ((tpos != strlen(expected)) || (memcmp(out, expected, tpos) != 0)) {
+		printf("> decoding failed, got \"%.*s\"\n", (int)tpos, out);
+		return 16;
+	}
+
+	/* 256 elements later "?" lines up with itself again, still garbage */
+	const uint8_t marks[] = { 1, 1, 3, 3, 1, 1 };
+	umorse_keydec_init(&dec, 100);
+	tpos = 0;
+	for (unsigned i = 0; i < 6 + 256; ++i) {
+		umorse_keydec_put(&dec, UMORSE_KEY_ON | (100 * (((i % 256) < 6) ? marks[i % 256] : 1)),
+						  out, sizeof(out));
+		umorse_keydec_put(&dec, 100, out, sizeof(out));
+	}
+	tpos += umorse_keydec_put(&dec, 300, out + tpos, sizeof(out) - tpos);
+	umorse_keydec_put(&dec, UMORSE_KEY_ON | 100, out + tpos, sizeof(out) - tpos);
+	tpos += umorse_keydec_put(&dec, 300, out + tpos, sizeof(out) - tpos);
+	if ((tpos != 1) || (out[0] != 'E')) {
+		printf("> overlong code word decoded to \"%.*s\"\n", (int)tpos, out);
+		return 65;
+	}
+	return 0;
+}
+
+int test_umorse_simd(void)
+{
+	static char bulk[1U << 16];
+	static uint8_t scalar[4 * sizeof(bulk)];
+	static uint8_t simd[4 * sizeof(bulk)];
+	const char *text = "The quick brown fox jumps over the lazy dog 1234567890.\n";
+
+	printf("> Compare vectorized to scalar encoding:\n");
+	srand(3);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		/* every byte value, but mostly text */
+		bulk[i] = (rand() & 1) ? (char)(rand() & 0xFF)
+							   : text[rand() % strlen(text)];
+	}
+	unsigned top = umorse_simd_level();
+	for (unsigned level = UMORSE_SIMD_NONE; level <= top; ++level) {
+		umorse_simd_set_level(level);
+		for (unsigned i = 0; i < 500; ++i) {
+			/* random offsets and lengths, some truncated by output */
+			size_t off = rand() % 64;
+			size_t tlen = rand() % 1024;
+			size_t clen = (i & 1) ? 1 + rand() % (4 * tlen + 4) : sizeof(simd);
+			int exp = umorse_encode_aligned(bulk + off, tlen, scalar, clen);
+			int ret = umorse_simd_encode_aligned(bulk + off, tlen, simd, clen);
+			if ((ret != exp) || ((ret > 0) && (memcmp(scalar, simd, ret) != 0))) {
+				printf("> level %u differs, tlen=%zu, clen=%zu\n", level, tlen, clen);
+				return 17;
+			}
+		}
+	}
+	/* throughput per level is measured by the benchmark */
+	umorse_simd_set_level(top);
+	return 0;
+}
+
+int test_umorse_parallel(void)
+{
+	static char bulk[1U << 20];
+	static uint8_t whole[4 * sizeof(bulk)];
+	static uint8_t parallel[4 * sizeof(bulk)];
+	const char *text = "The quick brown fox jumps over the lazy dog 1234567890.\n";
+
+	printf("> Encode with multiple threads and compare to umorse_encode:\n");
+	srand(4);
+	for (size_t i = 0; i < sizeof(bulk); ++i) {
+		bulk[i] = text[rand() % strlen(text)];
+	}
+	/* ignored chars only, leaves chunks without whole bytes */
+	memset(bulk + sizeof(bulk) / 2, 0x80, sizeof(bulk) / 4);
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		int len = umorse_encode(bulk, sizeof(bulk), whole, sizeof(whole), flags);
+		if ((size_t)len != umorse_encode_len(bulk, sizeof(bulk), flags)) {
+			printf("> encoded length differs in mode %u\n", flags);
+			return 18;
+		}
+		for (unsigned threads = 0; threads <= 8; ++threads) {
+			/* odd lengths shift the chunk boundaries within bytes */
+			size_t tlen = sizeof(bulk) - threads;
+			size_t cused = 0;
+			len = umorse_encode(bulk, tlen, whole, sizeof(whole), flags);
+			int ret = umorse_encode_parallel(bulk, tlen, parallel, sizeof(parallel),
+											 &cused, flags, threads);
+			if ((ret != 0) || (cused != (size_t)len) ||
+				(memcmp(whole, parallel, len) != 0)) {
+				printf("> %u threads differ in mode %u\n", threads, flags);
+				return 19;
+			}
+		}
+		size_t clen = umorse_encode_bits(bulk, 100, flags) / 8 + UMORSE_THRESHOLD;
+		size_t cused = 0;
+		if ((umorse_encode_parallel(bulk, 100, parallel, clen - 1, &cused, flags, 1) >= 0) ||
+			(umorse_encode_parallel(bulk, 100, parallel, clen, &cused, flags, 1) != 0)) {
+			printf("> output buffer size check failed in mode %u\n", flags);
+			return 20;
+		}
+	}
+
+	/* wall clock, as cpu time adds up over all threads */
+	for (uint8_t flags = 0; flags < 2; ++flags) {
+		for (unsigned threads = 1; threads <= 4; threads *= 2) {
+			struct timespec start, stop;
+			size_t cused;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (unsigned i = 0; i < 20U; ++i) {
+				umorse_encode_parallel(bulk, sizeof(bulk), parallel, sizeof(parallel),
+									   &cused, flags, threads);
+			}
+			clock_gettime(CLOCK_MONOTONIC, &stop);
+			double secs = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;
+			if (secs > 0) {
+				printf("> encoded %s with %u threads at %.1f MB/s\n",
+					   (flags & UMORSE_CODE_COMPACT) ? "compact" : "aligned",
+					   threads, 20.0 * sizeof(bulk) / secs / 1e6);
+			}
+		}
+	}
+	return 0;
+}
+
+#define SCHED_MSGS		(8U)
+#define SCHED_REPEAT	(2U)
+
+typedef struct {
+	umorse_out_t out;
+	umorse_job_t job;
+	umorse_sched_t *sched;
+	const record_t *exp;
+	size_t idx;
+	uint64_t t;
+	unsigned runs;
+	unsigned err;
+	uint64_t late;
+	unsigned overdue;
+} channel_t;
+
+static void _ch_put(channel_t *ch, uint8_t e)
+{
+	uint64_t now = ch->sched->now;
+	if ((ch->idx >= ch->exp->len) || (ch->exp->events[ch->idx] != e) ||
+		(now != ch->t)) {
+		++ch->err;
+	}
+	uint64_t clock = umorse_sched_clock();
+	uint64_t late = (clock > now) ? clock - now : 0;
+	if (late > ch->late) {
+		ch->late = late;
+	}
+	/* more than half a dit late, as the listener will notice */
+	if (late > ch->job.dit / 2) {
+		++ch->overdue;
+	}
+	ch->t += (uint64_t)((e == UMORSE_DAH) ? 3 : (e & UMORSE_MASK_COUNT)) * ch->job.dit;
+	++ch->idx;
+}
+
+static void _ch_dit(void *args, uint8_t flags)
+{
+	if (!(flags & UMORSE_FLAG_NODELAY)) {
+		((channel_t *)args)->err++;
+	}
+	_ch_put(args, UMORSE_DIT);
+}
+
+static void _ch_dah(void *args, uint8_t flags)
+{
+	(void) flags;
+	_ch_put(args, UMORSE_DAH);
+}
+
+static void _ch_nil(void *args, uint8_t flags)
+{
+	_ch_put(args, UMORSE_SPAN_NIL | (flags & UMORSE_MASK_COUNT));
+}
+
+static void _ch_batch(void *args, const uint8_t *span, size_t len, uint8_t flags)
+{
+	(void) flags;
+	for (size_t i = 0; i < len; ++i) {
+		_ch_put(args, span[i]);
+	}
+}
+
+static void _ch_done(umorse_job_t *job, void *arg)
+{
+	channel_t *ch = arg;
+	if ((ch->idx != ch->exp->len) || (ch->sched->now != ch->t)) {
+		++ch->err;
+	}
+	/* beacons repeat their message */
+	if (++ch->runs < SCHED_REPEAT) {
+		ch->idx = 0;
+		umorse_job_init(job, job->out, job->code, job->clen, job->dit, 0);
+		job->done = _ch_done;
+		job->arg = ch;
+		umorse_sched_add(ch->sched, job, ch->t);
+	}
+}
+
+static size_t _sched_setup(umorse_sched_t *sched, umorse_job_t **heap,
+						   channel_t *chs, size_t cnt, uint8_t code[][CODE_LEN],
+						   const int *clen, const record_t *exp,
+						   uint32_t dit, uint64_t start)
+{
+	size_t elements = 0;
+	umorse_sched_init(sched, heap, cnt);
+	for (size_t i = 0; i < cnt; ++i) {
+		channel_t *ch = &chs[i];
+		unsigned m = i % SCHED_MSGS;
+		/* mix single element and batch outputs */
+		if (i & 1) {
+			ch->out = (umorse_out_t){ .params = ch, .batch = _ch_batch };
+		}
+		else {
+			ch->out = (umorse_out_t){
+				.dit = _ch_dit, .dah = _ch_dah, .nil = _ch_nil, .params = ch
+			};
+		}
+		ch->sched = sched;
+		ch->exp = &exp[m];
+		ch->idx = 0;
+		ch->runs = 0;
+		ch->err = 0;
+		ch->late = 0;
+		ch->overdue = 0;
+		ch->t = start + (uint64_t)(rand() % 1000) * dit / 100;
+		umorse_job_init(&ch->job, &ch->out, code[m], clen[m], dit + (i % 37) * dit / 10, 0);
+		ch->job.done = _ch_done;
+		ch->job.arg = ch;
+		if (umorse_sched_add(sched, &ch->job, ch->t) != 0) {
+			return 0;
+		}
+		elements += SCHED_REPEAT * exp[m].len;
+	}
+	return elements;
+}
+
+int test_umorse_sched(void)
+{
+	static channel_t chs[8192];
+	static umorse_job_t *heap[8192];
+	static uint8_t code[SCHED_MSGS][CODE_LEN];
+	static record_t exp[SCHED_MSGS];
+	static int clen[SCHED_MSGS];
+	umorse_sched_t sched;
+
+	printf("> Schedule many channels on a virtual clock:\n");
+	for (unsigned m = 0; m < SCHED_MSGS; ++m) {
+		char msg[32];
+		snprintf(msg, sizeof(msg), "CQ CQ DE BEACON%u  %u K", m, m * 1234);
+		clen[m] = umorse_encode(msg, strlen(msg), code[m], CODE_LEN, m & 1);
+		const umorse_out_t out_rec = { .params = &exp[m], .batch = _rec_batch };
+		exp[m].len = 0;
+		umorse_output(&out_rec, code[m], clen[m], UMORSE_FLAG_NODELAY);
+	}
+	srand(5);
+	double ns[2] = { 0 };
+	for (size_t cnt = 1024; cnt <= 8192; cnt *= 8) {
+		size_t elements = _sched_setup(&sched, heap, chs, cnt, code, clen, exp,
+									   50000, 0);
+		size_t done = 0;
+		uint64_t now = 0;
+		uint64_t start = umorse_sched_clock();
+		/* a coarse 1 ms tick, jobs catch up in order of deadlines */
+		while (umorse_sched_next(&sched) != UMORSE_SCHED_IDLE) {
+			now += 1000;
+			done += umorse_sched_run(&sched, now);
+		}
+		uint64_t us = umorse_sched_clock() - start;
+		for (size_t i = 0; i < cnt; ++i) {
+			if (chs[i].err || (chs[i].runs != SCHED_REPEAT)) {
+				printf("> channel %zu failed, %u errors\n", i, chs[i].err);
+				return 21;
+			}
+		}
+		if (done != elements) {
+			printf("> output %zu of %zu elements\n", done, elements);
+			return 22;
+		}
+		ns[cnt > 1024] = us * 1e3 / done;
+		printf("> %zu channels, %zu elements at %.0f ns per element\n",
+			   cnt, done, ns[cnt > 1024]);
+	}
+	/* O(log n) per element, 8 times the channels cost 1.3 times as much,
+	 * with room for cache misses of the larger heap */
+	if (ns[1] > 4 * ns[0]) {
+		printf("> per element cost grows from %.0f to %.0f ns\n", ns[0], ns[1]);
+		return 61;
+	}
+
+	/* dense code is rejected, not played as pairs of bits */
+	umorse_sched_init(&sched, heap, 1);
+	umorse_job_init(&chs[0].job, &chs[0].out, code[0], clen[0], 2000, UMORSE_FLAG_DENSE);
+	if ((umorse_sched_add(&sched, &chs[0].job, 0) >= 0) || (sched.len != 0)) {
+		printf("> dense job scheduled\n");
+		return 64;
+	}
+
+	printf("> Schedule channels on the monotonic clock:\n");
+	size_t cnt = 64;
+	size_t elements = _sched_setup(&sched, heap, chs, cnt, code, clen, exp, 2000,
+								   umorse_sched_clock() + 1000);
+	if (umorse_sched_loop(&sched) != 0) {
+		return 23;
+	}
+	uint64_t late = 0;
+	size_t overdue = 0;
+	for (size_t i = 0; i < cnt; ++i) {
+		if (chs[i].err || (chs[i].runs != SCHED_REPEAT)) {
+			printf("> channel %zu failed, %u errors\n", i, chs[i].err);
+			return 24;
+		}
+		late = (chs[i].late > late) ? chs[i].late : late;
+		overdue += chs[i].overdue;
+	}
+	printf("> %zu channels, max latency %lu us, %zu of %zu elements overdue\n",
+		   cnt, (unsigned long)late, overdue, elements);
+	/* wakeups of a loaded host alone take up to 8 dits now and then, so
+	 * few elements may be overdue, and none by more than 25 dits */
+	if ((overdue * 50 > elements) || (late > 25 * 2000)) {
+		return 62;
+	}
+	return 0;
+}
+
+static int _cli_file(char *path, const char *data, size_t len)
+{
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		return -1;
+	}
+	ssize_t n = write(fd, data, len);
+	close(fd);
+	return ((size_t)n == len) ? 0 : -1;
+}
+
+int test_umorse_cli(void)
+{
+	/* crosses the 1 MiB input blocks of the tool, not a multiple of them */
+	static char text[3 * (1U << 19) + 7];
+	static char dec[sizeof(text) + 1];
+	static const char words[] = "CQ DE DL0ABC 73 ";
+	const char *modes[] = { "-a", "-c" };
+	const size_t lens[] = { 0, sizeof(text) };
+	char cmd[512];
+
+	printf("> Round trip files through the command line tool:\n");
+	for (size_t i = 0; i < sizeof(text); ++i) {
+		text[i] = words[i % (sizeof(words) - 1)];
+	}
+	/* no trailing space, that is dropped as part of the final stop */
+	text[sizeof(text) - 1] = 'E';
+	for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); ++l) {
+		for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); ++m) {
+			char in[] = "/tmp/umorse_in_XXXXXX";
+			char code[] = "/tmp/umorse_code_XXXXXX";
+			char out[] = "/tmp/umorse_out_XXXXXX";
+			if ((_cli_file(in, text, lens[l]) < 0) || (_cli_file(code, "", 0) < 0) ||
+				(_cli_file(out, "", 0) < 0)) {
+				return 68;
+			}
+			snprintf(cmd, sizeof(cmd), "%s %s -o %s %s && %s -d -o %s %s",
+					 TEST_CLI, modes[m], code, in, TEST_CLI, out, code);
+			int ret = system(cmd);
+			FILE *f = fopen(out, "rb");
+			size_t n = f ? fread(dec, 1, sizeof(dec), f) : 0;
+			if (f) {
+				fclose(f);
+			}
+			unlink(in);
+			unlink(code);
+			unlink(out);
+			if ((ret != 0) || (n != lens[l]) || (memcmp(dec, text, n) != 0)) {
+				printf("> %zu bytes in mode %s came back as %zu bytes\n",
+					   lens[l], modes[m], n);
+				return 69;
+			}
+		}
+	}
+	return 0;
+}
+
 int main(void)
 {
 	int ret = 1;
 	ret = test_umorse_print();
+	if (ret == 0) {
+		ret = test_umorse_decode();
+	}
+	if (ret == 0) {
+		ret = test_umorse_encode();
+	}
+	if (ret == 0) {
+		ret = test_umorse_encoder();
+	}
+	if (ret == 0) {
+		ret = test_umorse_decoder();
+	}
+	if (ret == 0) {
+		ret = test_umorse_output_batch();
+	}
+	if (ret == 0) {
+		ret = test_umorse_render();
+	}
+	if (ret == 0) {
+		ret = test_umorse_index();
+	}
+	if (ret == 0) {
+		ret = test_umorse_dense();
+	}
+	if (ret == 0) {
+		ret = test_umorse_stats();
+	}
+	if (ret == 0) {
+		ret = test_umorse_ring();
+	}
+	if (ret == 0) {
+		ret = test_umorse_convert();
+	}
+	if (ret == 0) {
+		ret = test_umorse_symbols();
+	}
+	if (ret == 0) {
+		ret = test_umorse_utf8();
+	}
+	if (ret == 0) {
+		ret = test_umorse_constexpr();
+	}
+	if (ret == 0) {
+		ret = test_umorse_timeline();
+	}
+	if (ret == 0) {
+		ret = test_umorse_bitmap();
+	}
+	if (ret == 0) {
+		ret = test_umorse_pcm();
+	}
+	if (ret == 0) {
+		ret = test_umorse_tone();
+	}
+	if (ret == 0) {
+		ret = test_umorse_skim();
+	}
+	if (ret == 0) {
+		ret = test_umorse_keydec();
+	}
+	if (ret == 0) {
+		ret = test_umorse_simd();
+	}
+	if (ret == 0) {
+		ret = test_umorse_parallel();
+	}
+	if (ret == 0) {
+		ret = test_umorse_sched();
+	}
+	if (ret == 0) {
+		ret = test_umorse_cli();
+	}
 	return ret;
 }
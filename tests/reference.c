@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse_tests
+ * @{
+ * @file
+ * @brief       Reference encoder classifying each char with branches
+ *
+ * The encode loop as it was before the lookup table: test for letter,
+ * number, space and stop in turn, then punctuation, and write each code
+ * word on its own. Compact code is ORed into the output byte by byte.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "reference.h"
+#include "symbols.h"
+#include "umorse.h"
+
+/* worst case bytes per char, a long symbol in aligned mode */
+#define REFERENCE_CHAR_MAX      (3U)
+
+static inline char _to_upper(char c)
+{
+    return (c - 32);
+}
+
+static inline char _is_letter(const char l)
+{
+    if ((l >= 'A') && (l <= 'Z')) {
+        return l;
+    }
+    else if ((l >= 'a') && (l <= 'z')) {
+        return _to_upper(l);
+    }
+
+    return 0;
+}
+
+static inline char _is_number(const char n)
+{
+    if ((n >= '0') && (n <= '9')) {
+        return n;
+    }
+    return 0;
+}
+
+static inline char _is_space(const char s)
+{
+    if ((s == '\t') || (s == ' ')) {
+        return ' ';
+    }
+    return 0;
+}
+
+static inline char _is_stop(const char s)
+{
+    if ((s > 0) && (s < ' ') && !_is_space(s)) {
+        return '\n';
+    }
+    return 0;
+}
+
+static uint16_t _code_word(const char c)
+{
+    switch (c) {
+#define REFERENCE_CASE(ch, cw)  case (ch): return (cw);
+        UMORSE_SYMBOLS(REFERENCE_CASE)
+#undef REFERENCE_CASE
+    }
+    return UMORSE_SKIP;
+}
+
+static size_t _encode_compact(uint16_t cc, uint8_t *code, size_t cpos,
+                              unsigned *shift)
+{
+    for (unsigned j = 0; (j < 8) && (cc >> (j * UMORSE_SHIFT)); ++j) {
+        if (*shift == 4) {
+            code[++cpos] = 0;
+            *shift = 0;
+        }
+        uint8_t tmp = (uint8_t)(cc >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+        code[cpos] |= (tmp << (UMORSE_SHIFT * *shift));
+        ++*shift;
+    }
+    if (*shift == 4) {
+        code[++cpos] = 0;
+        *shift = 0;
+    }
+    if ((cc & UMORSE_MASK) != UMORSE_END_CHAR) {
+        /* add inter char gap */
+        code[cpos] |= (uint8_t)UMORSE_END_CHAR << (UMORSE_SHIFT * *shift);
+        ++*shift;
+    }
+    return cpos;
+}
+
+static size_t _encode_aligned(uint16_t cc, uint8_t *code, size_t cpos)
+{
+    code[cpos++] = (uint8_t)(cc & 0xFF);
+    if (cc > 0xFF) {
+        /* a number or special char is encoded in 2 bytes */
+        code[cpos++] = (uint8_t)(cc >> 8);
+    }
+    if ((cc & UMORSE_MASK) != UMORSE_END_CHAR) {
+        /* add inter char gap */
+        code[cpos++] = (uint8_t)(UMORSE_END_CHAR);
+    }
+    return cpos;
+}
+
+int umorse_encode_reference(const char *text, size_t tlen,
+                            uint8_t *code, size_t clen, uint8_t flags)
+{
+    size_t cpos = 0;
+    unsigned shift = 0;
+
+    if (clen < UMORSE_THRESHOLD) {
+        return -1;
+    }
+    code[0] = 0;
+    for (size_t tpos = 0; tpos < tlen; ++tpos) {
+        char tc = 0;
+        uint16_t cc = 0;
+        if ((cpos + REFERENCE_CHAR_MAX) > (clen - UMORSE_THRESHOLD)) {
+            return -1;
+        }
+        if ((tc = _is_letter(text[tpos])) != 0) {
+            cc = _code_word(tc);
+        }
+        else if ((tc = _is_number(text[tpos])) != 0) {
+            cc = _code_word(tc);
+        }
+        else if (_is_space(text[tpos])) {
+            cc = UMORSE_END_WORD;
+        }
+        else if (_is_stop(text[tpos])) {
+            cc = UMORSE_END_STOP;
+        }
+        else if ((cc = _code_word(text[tpos])) == UMORSE_SKIP) {
+            /* any other char is ignored */
+            continue;
+        }
+
+        if (flags & UMORSE_CODE_COMPACT) {
+            cpos = _encode_compact(cc, code, cpos, &shift);
+        }
+        else {
+            cpos = _encode_aligned(cc, code, cpos);
+        }
+    }
+    /* add final stop char to close code */
+    if (flags & UMORSE_CODE_COMPACT) {
+        cpos = _encode_compact(UMORSE_END_STOP, code, cpos, &shift);
+        /* length up to the last byte holding elements */
+        return (int)cpos + (shift > 0);
+    }
+    return (int)_encode_aligned(UMORSE_END_STOP, code, cpos);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse_tests
+ * @{
+ * @file
+ * @brief       Reference encoder classifying each char with branches
+ *
+ * Kept to check the table driven umorse_encode against and to compare its
+ * throughput in the benchmark.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+
+#ifndef UMORSE_REFERENCE_H
+#define UMORSE_REFERENCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief   Encodes text like umorse_encode, one branch per class of char
+ *
+ * @param[in]   text    Input text
+ * @param[in]   tlen    Length of text
+ * @param[out]  code    Output buffer for Morse code
+ * @param[in]   clen    Length of code buffer
+ * @param[in]   flags   UMORSE_CODE_ALIGNED or UMORSE_CODE_COMPACT
+ *
+ * @return  Length of code, or -1 if clen is too short
+ */
+int umorse_encode_reference(const char *text, size_t tlen,
+                            uint8_t *code, size_t clen, uint8_t flags);
+
+#endif /* UMORSE_REFERENCE_H */
+/** @} */
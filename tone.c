@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of uMorse decoder for PCM audio
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "keydec.h"
+#include "tone.h"
+#include "umorse.h"
+
+#ifndef M_PI
+#define M_PI                    (3.14159265358979323846)
+#endif
+
+int umorse_tone_init(umorse_tone_t *tone, uint32_t rate, unsigned freq,
+                     unsigned dit_ms)
+{
+    uint32_t block = (rate * UMORSE_TONE_BLOCK_MS) / 1000U;
+
+    if ((block == 0) || (freq >= rate / 2) || (dit_ms == 0)) {
+        return -1;
+    }
+    tone->coeff = (float)(2.0 * cos(2.0 * M_PI * freq / rate));
+    tone->s1 = 0;
+    tone->s2 = 0;
+    tone->peak = 0;
+    tone->block = block;
+    tone->n = 0;
+    tone->dur = 0;
+    tone->on = 0;
+    umorse_keydec_init(&tone->dec, (rate * dit_ms) / 1000U);
+    return 0;
+}
+
+int umorse_tone_process(umorse_tone_t *tone, const int16_t *samples, size_t len,
+                        size_t *used, char *text, size_t tlen)
+{
+    size_t tpos = 0;
+    size_t i = 0;
+    float s1 = tone->s1;
+    float s2 = tone->s2;
+    float coeff = tone->coeff;
+
+    while ((i < len) && ((tpos + 2) <= tlen)) {
+        /* run the Goertzel filter until the end of the block */
+        size_t end = i + (tone->block - tone->n);
+        if (end > len) {
+            end = len;
+        }
+        tone->n += end - i;
+        for (; i < end; ++i) {
+            float s = (float)samples[i] + coeff * s1 - s2;
+            s2 = s1;
+            s1 = s;
+        }
+        if (tone->n < tone->block) {
+            break;
+        }
+
+        /* amplitude of the tone within the block */
+        float power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+        float mag = 2.0f * sqrtf(power > 0 ? power : 0) / tone->block;
+        s1 = 0;
+        s2 = 0;
+        tone->n = 0;
+        tone->peak *= UMORSE_TONE_DECAY;
+        if (mag > tone->peak) {
+            tone->peak = mag;
+        }
+        uint8_t on = (mag > UMORSE_TONE_FLOOR) && (mag > tone->peak / 2);
+
+        if (on != tone->on) {
+            /* pass on the completed key down or key up period */
+            umorse_key_t key = (tone->on ? UMORSE_KEY_ON : 0) | tone->dur;
+            tpos += umorse_keydec_put(&tone->dec, key, text + tpos, tlen - tpos);
+            tone->on = on;
+            tone->dur = 0;
+        }
+        /* saturate, the key event keeps 31 bits for the duration */
+        if (tone->dur < UMORSE_KEY_DURATION - tone->block) {
+            tone->dur += tone->block;
+        }
+        else {
+            tone->dur = UMORSE_KEY_DURATION;
+        }
+        if (!on) {
+            tpos += umorse_keydec_idle(&tone->dec, tone->dur,
+                                       text + tpos, tlen - tpos);
+        }
+    }
+    tone->s1 = s1;
+    tone->s2 = s2;
+
+    if (used) {
+        *used = i;
+    }
+    return tpos;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse decoder for PCM audio
+ *
+ * Detects a Morse tone in 16 bit mono PCM samples with a Goertzel filter,
+ * evaluated over short blocks. The key level of each block is compared
+ * against a threshold that follows the signal peak, durations of key down
+ * and key up are measured and decoded by an adaptive key decoder. Samples
+ * are processed in chunks of any size with constant memory, characters are
+ * emitted as soon as their inter char gap is detected.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_TONE_H
+#define UMORSE_TONE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "keydec.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Tone detector parameters
+ * @{
+ */
+#ifndef UMORSE_TONE_BLOCK_MS
+#define UMORSE_TONE_BLOCK_MS        (5U)    /**< detection block length */
+#endif
+#ifndef UMORSE_TONE_FLOOR
+#define UMORSE_TONE_FLOOR           (300)   /**< min amplitude of a tone */
+#endif
+#define UMORSE_TONE_DECAY           (0.995f) /**< peak decay per block */
+/** @} */
+
+/**
+ * @brief   Tone decoder state
+ */
+typedef struct {
+    float coeff;        /**< Goertzel coefficient of the tone frequency */
+    float s1;           /**< Goertzel state, previous sample */
+    float s2;           /**< Goertzel state, sample before previous */
+    float peak;         /**< decaying peak amplitude of the tone */
+    uint32_t block;     /**< samples per block */
+    uint32_t n;         /**< samples in current block */
+    uint32_t dur;       /**< samples since the last key level change */
+    uint8_t on;         /**< current key level */
+    umorse_keydec_t dec;    /**< decoder of key durations */
+} umorse_tone_t;
+
+/**
+ * @brief   Initializes a tone decoder
+ *
+ * @param[out]  tone    Tone decoder state
+ * @param[in]   rate    Sample rate in Hz
+ * @param[in]   freq    Tone frequency in Hz
+ * @param[in]   dit_ms  Initial estimate of the dit duration in milli seconds
+ *
+ * @returns     0 on success
+ * @returns     < 0 on invalid parameters
+ */
+int umorse_tone_init(umorse_tone_t *tone, uint32_t rate, unsigned freq,
+                     unsigned dit_ms);
+
+/**
+ * @brief   Decodes the next chunk of PCM samples
+ *
+ * Word gaps and stops both decode to ' '. Processing stops early if the
+ * text buffer has less than 2 bytes left.
+ *
+ * @param[in,out]   tone    Tone decoder state
+ * @param[in]       samples Input samples
+ * @param[in]       len     Number of input samples
+ * @param[out]      used    Number of samples consumed, may be NULL
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer
+ *
+ * @returns     length of text written to output buffer
+ */
+int umorse_tone_process(umorse_tone_t *tone, const int16_t *samples, size_t len,
+                        size_t *used, char *text, size_t tlen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_TONE_H */
+/** @} */
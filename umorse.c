@@ -25,139 +25,39 @@
 
 #include <stddef.h>
 #include <stdint.h>
-#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "emit.h"
+#include "once.h"
+#include "stats.h"
+#include "symbols.h"
 #include "umorse.h"
 
-static const uint8_t umorse_letters[] = {
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))),  /**< ._     = A */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< _...   = B */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< _._.   = C */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))),  /**< _..    = D */
-    (UMORSE_DIT),                                       /**< .      = E */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< .._.   = F */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))),  /**< __.    = G */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< ....   = H */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))),  /**< ..     = I */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))),  /**< .___   = J */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))),  /**< _._    = K */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< ._..   = L */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))),  /**< __     = M */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))),  /**< _.     = N */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))),  /**< ___    = O */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< .__.   = P */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))),  /**< __._   = Q */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))),  /**< ._.    = R */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))),  /**< ...    = S */
-    (UMORSE_DAH),                                       /**< _      = T */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))),  /**< .._    = U */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))),  /**< ..._   = V */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))),  /**< .__    = W */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))),  /**< _.._   = X */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))),  /**< _.__   = Y */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))),  /**< __..   = Z */
-};
+#define UMORSE_ENCODE_ENTRY_LEN     (3U)
+#define UMORSE_ENCODE_LEN_SHIFT     (24U)
+#define UMORSE_ENCODE_ELEMS_SHIFT   (28U)
+#define UMORSE_RENDER_BODY_LEN      (8U)
+#define UMORSE_RENDER_GAP_LEN       (4U)
 
-static const uint16_t umorse_numbers[] = {
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (4 * UMORSE_SHIFT))),  /**< _____  = 0 */
-    (UMORSE_DIT | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (4 * UMORSE_SHIFT))),  /**< .____  = 1 */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (4 * UMORSE_SHIFT))),  /**< ..___  = 2 */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (4 * UMORSE_SHIFT))),  /**< ...__  = 3 */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (4 * UMORSE_SHIFT))),  /**< ...._  = 4 */
-    (UMORSE_DIT | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (4 * UMORSE_SHIFT))),  /**< .....  = 5 */
-    (UMORSE_DAH | (UMORSE_DIT << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (4 * UMORSE_SHIFT))),  /**< _....  = 6 */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (4 * UMORSE_SHIFT))),  /**< __...  = 7 */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (3 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (4 * UMORSE_SHIFT))),  /**< ___..  = 8 */
-    (UMORSE_DAH | (UMORSE_DAH << (1 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (2 * UMORSE_SHIFT))
-                | (UMORSE_DAH << (3 * UMORSE_SHIFT))
-                | (UMORSE_DIT << (4 * UMORSE_SHIFT))),  /**< ____.  = 9 */
+/**
+ * @brief   Code words by input byte, generated from the symbol list
+ *
+ * Lower case letters are folded before the lookup, bytes without a code
+ * word are UMORSE_SKIP.
+ */
+static const uint16_t umorse_symbols[256] = {
+#define UMORSE_SYMBOL_ENTRY(c, cw)  [(uint8_t)(c)] = (cw),
+    UMORSE_SYMBOLS(UMORSE_SYMBOL_ENTRY)
+#undef UMORSE_SYMBOL_ENTRY
 };
 
 static inline char _to_upper(char c)
 {
-    assert ((c >= 'a') && (c <= 'z'));
-
-    return (c - 32);
-}
-
-static inline char _is_letter(const char l)
-{
-    if ((l >= 'A') && (l <= 'Z')) {
-        return l;
-    }
-    else if ((l >= 'a') && (l <= 'z')) {
-        return _to_upper(l);
+    if ((c >= 'a') && (c <= 'z')) {
+        return (c - 32);
     }
-
-    return 0;
-}
-
-static inline char _is_number(const char n)
-{
-    if ((n >= '0') && (n <= '9')) {
-        return n;
-    }
-    return 0;
+    return c;
 }
 
 static inline char _is_space(const char s)
@@ -176,37 +76,54 @@ static inline char _is_stop(const char s)
     return 0;
 }
 
-size_t _encode_compact(uint16_t cc, uint8_t *code, size_t clen, size_t cpos)
+static inline uint16_t _classify(const char c)
 {
-    assert (cpos < clen);
-    (void) clen;
-
-    unsigned shift = 0;
-
-    while (((code[cpos] >> (shift * UMORSE_SHIFT)) > 0) && (shift < 4)){
-        ++shift;
+    if (_is_space(c)) {
+        return UMORSE_END_WORD;
+    }
+    else if (_is_stop(c)) {
+        return UMORSE_END_STOP;
     }
+    /* any other char without code word is ignored */
+    return umorse_symbols[(uint8_t)_to_upper(c)];
+}
 
-    UMORSE_DEBUG ("cc=0x%04x, cpos=%2lu, shift=%u\n", cc, cpos, shift);
+/**
+ * @brief   State of the compact bit writer
+ *
+ * Elements are collected in a register sized accumulator, starting at bit 0,
+ * and written to the output in whole words, such that the output buffer is
+ * never read and needs no initialization.
+ */
+typedef struct {
+    uint64_t acc;       /**< pending elements not yet written */
+    unsigned bits;      /**< number of valid bits in acc */
+} _bitwriter_t;
 
-    for (unsigned j = 0; (j < 8) && (cc >> (j * UMORSE_SHIFT)); ++j) {
-        if (shift == 4) {
-            ++cpos;
-            shift = 0;
-        }
-        uint8_t tmp = (uint8_t)(cc >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
-        code[cpos] |= (tmp << (UMORSE_SHIFT * shift));
-        ++shift;
-    }
-    if (shift == 4) {
-        ++cpos;
-        shift = 0;
-    }
-    if ((cc & UMORSE_MASK) != UMORSE_END_CHAR) {
-        /* add inter char gap */
-        code[cpos] |= (uint8_t)UMORSE_END_CHAR << (UMORSE_SHIFT * shift);
+static inline size_t _bitwriter_put(_bitwriter_t *bw, uint32_t cw, unsigned bits,
+                                    uint8_t *code, size_t cpos)
+{
+    bw->acc |= (uint64_t)cw << bw->bits;
+    bw->bits += bits;
+    if (bw->bits >= 32) {
+        code[cpos++] = (uint8_t)(bw->acc);
+        code[cpos++] = (uint8_t)(bw->acc >> 8);
+        code[cpos++] = (uint8_t)(bw->acc >> 16);
+        code[cpos++] = (uint8_t)(bw->acc >> 24);
+        bw->acc >>= 32;
+        bw->bits -= 32;
     }
+    return cpos;
+}
 
+static inline size_t _bitwriter_flush(_bitwriter_t *bw, uint8_t *code, size_t cpos)
+{
+    /* write whole bytes only, a partial byte remains pending */
+    while (bw->bits >= 8) {
+        code[cpos++] = (uint8_t)(bw->acc);
+        bw->acc >>= 8;
+        bw->bits -= 8;
+    }
     return cpos;
 }
 
@@ -215,8 +132,6 @@ size_t _encode_aligned(uint16_t cc, uint8_t *code, size_t clen, size_t cpos)
     assert (cpos < clen);
     (void) clen;
 
-    UMORSE_DEBUG ("cc=0x%04x, cpos=%2lu\n", cc, cpos);
-
     code[cpos++] = (uint8_t)(cc & 0xFF);
     if (cc > 0xFF) {
         /* a number or special char is encoded in 2 bytes */
@@ -230,54 +145,332 @@ size_t _encode_aligned(uint16_t cc, uint8_t *code, size_t clen, size_t cpos)
     return cpos;
 }
 
-int umorse_encode(const char *text, size_t tlen,
-                  uint8_t *code, size_t clen, uint8_t flags)
+/**
+ * @brief   Lookup of input bytes to their aligned code
+ *
+ * Each entry holds the bytes _encode_aligned writes for that input byte,
+ * including the inter char gap, in bits 0-23 and their count in bits 24-27.
+ * Bits 28-31 hold the number of elements in compact mode, again including
+ * the gap. Ignored bytes have both counts 0. Generated once from the
+ * classification chain above, such that encoding needs a single table hit
+ * per input byte.
+ */
+static uint32_t umorse_encode_table[256];
+
+/* mask to recover the code word from an entry, indexed by its length */
+static const uint32_t umorse_encode_mask[] = { 0x0, 0xFF, 0xFF, 0xFFFF };
+
+/* symbols of each input byte in dense mode, base 3, first symbol lowest */
+static uint16_t umorse_dense_table[256];
+
+/* powers of 3, to append symbols to the dense accumulator */
+static const uint32_t umorse_dense_pow[] = {
+    1, 3, 9, 27, 81, 243, 729, 2187, 6561, 19683
+};
+
+/* entry of umorse_encode_table and dense symbols for a code word */
+static uint32_t _encode_entry(uint16_t cc, uint16_t *trits)
 {
+    uint8_t tmp[UMORSE_ENCODE_ENTRY_LEN] = { 0 };
+    uint32_t len = 0;
+    uint32_t elems = 0;
+
+    if (cc != UMORSE_SKIP) {
+        len = _encode_aligned(cc, tmp, sizeof(tmp), 0);
+        while (cc >> (elems * UMORSE_SHIFT)) {
+            ++elems;
+        }
+        if ((cc & UMORSE_MASK) != UMORSE_END_CHAR) {
+            ++elems;
+        }
+    }
+    /* gaps are symbol 0, as is the padding beyond cc */
+    *trits = 0;
+    for (unsigned k = 0; k < elems; ++k) {
+        uint8_t e = (cc >> (k * UMORSE_SHIFT)) & UMORSE_MASK;
+        if ((e == UMORSE_DIT) || (e == UMORSE_DAH)) {
+            *trits += e * umorse_dense_pow[k];
+        }
+    }
+    return tmp[0] | ((uint32_t)tmp[1] << 8) | ((uint32_t)tmp[2] << 16)
+           | (len << UMORSE_ENCODE_LEN_SHIFT)
+           | (elems << UMORSE_ENCODE_ELEMS_SHIFT);
+}
+
+static void _build_encode_table(void)
+{
+    for (unsigned i = 0; i < 256; ++i) {
+        umorse_encode_table[i] = _encode_entry(_classify((char)i),
+                                               &umorse_dense_table[i]);
+    }
+}
+
+static void _init_encode_table(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_encode_table);
+}
+
+uint64_t umorse_encode_bits(const char *text, size_t tlen, uint8_t flags)
+{
+    /* elements in compact mode, bytes in aligned mode */
+    unsigned shift = (flags & UMORSE_CODE_COMPACT) ? UMORSE_ENCODE_ELEMS_SHIFT
+                                                   : UMORSE_ENCODE_LEN_SHIFT;
+    uint64_t cnt = 0;
+
+    _init_encode_table();
+    for (size_t tpos = 0; tpos < tlen; ++tpos) {
+        cnt += (umorse_encode_table[(uint8_t)text[tpos]] >> shift) & UMORSE_MASK_COUNT;
+    }
+    return (flags & UMORSE_CODE_COMPACT) ? cnt * UMORSE_SHIFT : cnt * 8;
+}
+
+size_t umorse_encode_len(const char *text, size_t tlen, uint8_t flags)
+{
+    if (flags & UMORSE_CODE_DENSE) {
+        /* symbols plus final stop, last byte partly filled, end marker */
+        uint64_t syms = umorse_encode_bits(text, tlen, UMORSE_CODE_COMPACT)
+                        / UMORSE_SHIFT + 4;
+        return (size_t)((syms + UMORSE_DENSE_ELEMS - 1) / UMORSE_DENSE_ELEMS) + 1;
+    }
+    uint64_t bits = umorse_encode_bits(text, tlen, flags);
+
+    if (flags & UMORSE_CODE_COMPACT) {
+        /* final stop as 4 elements, last byte padded */
+        return (size_t)((bits + 4 * UMORSE_SHIFT + 7) / 8);
+    }
+    return (size_t)(bits / 8) + 1;
+}
+
+/* room to keep for the final stop */
+static inline size_t _threshold(uint8_t flags)
+{
+    return (flags & UMORSE_CODE_DENSE) ? UMORSE_THRESHOLD_DENSE : UMORSE_THRESHOLD;
+}
+
+#if UMORSE_STATS
+/* counts ignored bytes on the table lookup the encoder makes anyway */
+#define UMORSE_STATS_SKIPPED(skipped, e) \
+    ((skipped) += (((e) >> UMORSE_ENCODE_LEN_SHIFT) == 0))
+
+static void _stats_feed(size_t tlen, size_t tpos, size_t skipped)
+{
+    UMORSE_STATS_ADD(encode_calls, 1);
+    UMORSE_STATS_ADD(encode_bytes, tpos);
+    UMORSE_STATS_ADD(encode_skipped, skipped);
+    UMORSE_STATS_ADD(encode_truncated, tpos < tlen);
+}
+#else
+#define UMORSE_STATS_SKIPPED(skipped, e)
+#endif
+
+void umorse_encoder_init(umorse_encoder_t *enc, uint8_t flags)
+{
+    enc->acc = 0;
+    enc->bits = 0;
+    enc->flags = flags;
+    _init_encode_table();
+}
+
+int umorse_encoder_feed(umorse_encoder_t *enc, const char *text, size_t tlen,
+                        size_t *tused, uint8_t *code, size_t clen)
+{
+    size_t tpos = 0;
     size_t cpos = 0;
-    uint16_t cc = 0;
-    /* decrease code length for safe guard */
-    clen -= UMORSE_THRESHOLD;
-    /* encode give string into Morse code */
-    for (size_t tpos = 0; (tpos < tlen) && (cpos < clen); ++tpos) {
-        char tc = 0;
-        cc = 0;
-        if ((tc = _is_letter(text[tpos])) != 0) {
-            cc = umorse_letters[tc - UMORSE_LETTER_OFFSET];
+#if UMORSE_STATS
+    size_t skipped = 0;
+#endif
+
+    if (enc->flags & UMORSE_CODE_DENSE) {
+        /* acc holds pending symbols in base 3, bits their number */
+        uint32_t acc = (uint32_t)enc->acc;
+        unsigned syms = enc->bits;
+        for (; tpos < tlen; ++tpos) {
+            uint8_t c = (uint8_t)text[tpos];
+            uint32_t e = umorse_encode_table[c];
+            uint32_t elems = e >> UMORSE_ENCODE_ELEMS_SHIFT;
+            if ((cpos + (syms + elems) / UMORSE_DENSE_ELEMS) > clen) {
+                break;
+            }
+            UMORSE_STATS_SKIPPED(skipped, e);
+            acc += umorse_dense_table[c] * umorse_dense_pow[syms];
+            syms += elems;
+            while (syms >= UMORSE_DENSE_ELEMS) {
+                code[cpos++] = (uint8_t)(acc % UMORSE_DENSE_END);
+                acc /= UMORSE_DENSE_END;
+                syms -= UMORSE_DENSE_ELEMS;
+            }
+        }
+        enc->acc = acc;
+        enc->bits = (uint8_t)syms;
+    }
+    else if (enc->flags & UMORSE_CODE_COMPACT) {
+        _bitwriter_t bw = { enc->acc, enc->bits };
+        for (; tpos < tlen; ++tpos) {
+            uint32_t e = umorse_encode_table[(uint8_t)text[tpos]];
+            uint32_t len = (e >> UMORSE_ENCODE_LEN_SHIFT) & UMORSE_MASK_COUNT;
+            uint32_t elems = e >> UMORSE_ENCODE_ELEMS_SHIFT;
+            /* stop if the whole bytes of this char do not fit anymore */
+            if ((cpos + (bw.bits + elems * UMORSE_SHIFT) / 8) > clen) {
+                break;
+            }
+            UMORSE_STATS_SKIPPED(skipped, e);
+            /* append the inter char gap as last element, 0 if ignored */
+            uint32_t gap = ((uint32_t)UMORSE_END_CHAR << (UMORSE_SHIFT * (elems + 1)))
+                           >> (2 * UMORSE_SHIFT);
+            uint32_t cc = e & umorse_encode_mask[len];
+            cpos = _bitwriter_put(&bw, cc | gap, elems * UMORSE_SHIFT, code, cpos);
+        }
+        cpos = _bitwriter_flush(&bw, code, cpos);
+        enc->acc = bw.acc;
+        enc->bits = bw.bits;
+    }
+    else {
+        /* branch free while there is room to always write 3 bytes */
+        for (; (tpos < tlen) && ((cpos + UMORSE_ENCODE_ENTRY_LEN) <= clen); ++tpos) {
+            uint32_t e = umorse_encode_table[(uint8_t)text[tpos]];
+            code[cpos] = (uint8_t)e;
+            code[cpos + 1] = (uint8_t)(e >> 8);
+            code[cpos + 2] = (uint8_t)(e >> 16);
+            cpos += (e >> UMORSE_ENCODE_LEN_SHIFT) & UMORSE_MASK_COUNT;
+            UMORSE_STATS_SKIPPED(skipped, e);
         }
-        else if ((tc = _is_number(text[tpos])) != 0) {
-            cc = umorse_numbers[tc - UMORSE_NUMBER_OFFSET];
+        for (; tpos < tlen; ++tpos) {
+            uint32_t e = umorse_encode_table[(uint8_t)text[tpos]];
+            uint32_t len = (e >> UMORSE_ENCODE_LEN_SHIFT) & UMORSE_MASK_COUNT;
+            if ((cpos + len) > clen) {
+                break;
+            }
+            UMORSE_STATS_SKIPPED(skipped, e);
+            for (unsigned i = 0; i < len; ++i) {
+                code[cpos++] = (uint8_t)(e >> (8 * i));
+            }
         }
-        else if (_is_space(text[tpos])) {
-            cc = UMORSE_END_WORD;
+    }
+#if UMORSE_STATS
+    _stats_feed(tlen, tpos, skipped);
+#endif
+
+    if (tused) {
+        *tused = tpos;
+    }
+    return cpos;
+}
+
+int umorse_encoder_put(umorse_encoder_t *enc, uint16_t cc,
+                       uint8_t *code, size_t clen)
+{
+    /* inter char gap, unless cc is a gap itself */
+    uint32_t gap = (cc & UMORSE_MASK) != UMORSE_END_CHAR;
+    uint32_t elems = gap;
+    size_t cpos = 0;
+
+    if (cc == UMORSE_SKIP) {
+        return 0;
+    }
+    while (cc >> ((elems - gap) * UMORSE_SHIFT)) {
+        ++elems;
+    }
+    if (enc->flags & UMORSE_CODE_DENSE) {
+        uint16_t trits;
+        uint32_t acc = (uint32_t)enc->acc;
+        unsigned syms = enc->bits;
+        if (((syms + elems) / UMORSE_DENSE_ELEMS) > clen) {
+            return -1;
         }
-        else if (_is_stop(text[tpos])) {
-            cc = UMORSE_END_STOP;
+        _encode_entry(cc, &trits);
+        acc += trits * umorse_dense_pow[syms];
+        syms += elems;
+        while (syms >= UMORSE_DENSE_ELEMS) {
+            code[cpos++] = (uint8_t)(acc % UMORSE_DENSE_END);
+            acc /= UMORSE_DENSE_END;
+            syms -= UMORSE_DENSE_ELEMS;
         }
-        else {
-            /* any other char is ignored */
-            continue;
+        enc->acc = acc;
+        enc->bits = (uint8_t)syms;
+    }
+    else if (enc->flags & UMORSE_CODE_COMPACT) {
+        _bitwriter_t bw = { enc->acc, enc->bits };
+        if (((bw.bits + elems * UMORSE_SHIFT) / 8) > clen) {
+            return -1;
         }
+        cpos = _bitwriter_put(&bw, cc | (gap * UMORSE_END_CHAR << ((elems - 1) * UMORSE_SHIFT)),
+                              elems * UMORSE_SHIFT, code, cpos);
+        cpos = _bitwriter_flush(&bw, code, cpos);
+        enc->acc = bw.acc;
+        enc->bits = bw.bits;
+    }
+    else {
+        if ((1 + (cc > 0xFF) + gap) > clen) {
+            return -1;
+        }
+        cpos = _encode_aligned(cc, code, clen, cpos);
+    }
+    return cpos;
+}
+
+int umorse_encoder_finish(umorse_encoder_t *enc, uint8_t *code, size_t clen)
+{
+    size_t cpos = 0;
 
-        if (flags & UMORSE_CODE_COMPACT) {
-            cpos = _encode_compact(cc, code, clen, cpos);
+    if (clen < _threshold(enc->flags)) {
+        return -1;
+    }
+    if (enc->flags & UMORSE_CODE_DENSE) {
+        /* final stop as 4 gap symbols, which are 0 */
+        uint32_t acc = (uint32_t)enc->acc;
+        unsigned syms = enc->bits + 4;
+        while (syms >= UMORSE_DENSE_ELEMS) {
+            code[cpos++] = (uint8_t)(acc % UMORSE_DENSE_END);
+            acc /= UMORSE_DENSE_END;
+            syms -= UMORSE_DENSE_ELEMS;
+        }
+        if (syms > 0) {
+            code[cpos++] = (uint8_t)acc;
         }
         else {
-            cpos = _encode_aligned(cc, code, clen, cpos);
+            syms = UMORSE_DENSE_ELEMS;
         }
+        code[cpos++] = (uint8_t)(UMORSE_DENSE_END + syms);
     }
-    /* add final stop char to close code */
-    cc = (uint8_t) UMORSE_END_STOP;
-    if (flags & UMORSE_CODE_COMPACT) {
-        cpos = _encode_compact(cc, code, clen, cpos);
+    else if (enc->flags & UMORSE_CODE_COMPACT) {
+        _bitwriter_t bw = { enc->acc, enc->bits };
+        cpos = _bitwriter_put(&bw, UMORSE_END_STOP, 4 * UMORSE_SHIFT, code, cpos);
+        cpos = _bitwriter_flush(&bw, code, cpos);
+        if (bw.bits > 0) {
+            /* pad last byte with UMORSE_NUL elements */
+            code[cpos++] = (uint8_t)bw.acc;
+        }
     }
     else {
-        cpos = _encode_aligned(cc, code, clen, cpos);
+        cpos = _encode_aligned(UMORSE_END_STOP, code, clen, cpos);
     }
-    /* add 1 to return length and not current position */
-    ++cpos;
+    umorse_encoder_init(enc, enc->flags);
     return cpos;
 }
 
+int umorse_encode(const char *text, size_t tlen,
+                  uint8_t *code, size_t clen, uint8_t flags)
+{
+    umorse_encoder_t enc;
+
+    if (clen < _threshold(flags)) {
+        return -1;
+    }
+    umorse_encoder_init(&enc, flags);
+    /* keep room for the final stop char to close code */
+    int cpos = umorse_encoder_feed(&enc, text, tlen, NULL,
+                                   code, clen - _threshold(flags));
+    return cpos + umorse_encoder_finish(&enc, code + cpos, clen - cpos);
+}
+
+int umorse_encode_dense(const char *text, size_t tlen,
+                        uint8_t *code, size_t clen)
+{
+    return umorse_encode(text, tlen, code, clen, UMORSE_CODE_DENSE);
+}
+
 int umorse_encode_compact(const char *text, size_t tlen,
                           uint8_t *code, size_t clen)
 {
@@ -290,59 +483,640 @@ int umorse_encode_aligned(const char *text, size_t tlen,
     return umorse_encode(text, tlen, code, clen, UMORSE_CODE_ALIGNED);
 }
 
-int umorse_decode(const uint8_t *code, size_t clen, char *text, size_t tlen)
+/**
+ * @brief   Perfect hash of code words to characters
+ *
+ * Each entry holds a code word in bits 8-23 and its character in bits 0-7,
+ * in the slot _hash gives for it. The multiplier is searched on init such
+ * that no two code words of the symbol list share a slot. Any other code
+ * word fails the compare, so a lookup takes a single load, whatever the
+ * number of symbols.
+ */
+static uint32_t umorse_decode_hash[1U << UMORSE_DECODE_HASH_BITS];
+static uint16_t umorse_decode_mult;
+
+static inline unsigned _hash(uint16_t cc, uint16_t mult)
 {
-    (void) code;
-    (void) clen;
-    (void) text;
-    (void) tlen;
+    return (uint16_t)(cc * mult) >> (16 - UMORSE_DECODE_HASH_BITS);
+}
 
-    UMORSE_DEBUG("NOT IMPLEMENTED YET!\n");
+static inline char _lookup(uint16_t cc)
+{
+    uint32_t e = umorse_decode_hash[_hash(cc, umorse_decode_mult)];
 
-    return 0;
+    return ((e >> 8) == cc) ? (char)e : 0;
+}
+
+/* symbols of the list, the hash keeps at most half of its slots in use */
+#define UMORSE_SYMBOL_COUNT(c, cw)  + 1
+_Static_assert((0 UMORSE_SYMBOLS(UMORSE_SYMBOL_COUNT)) <= (1U << UMORSE_DECODE_HASH_BITS) / 2,
+               "too many symbols for UMORSE_DECODE_HASH_BITS");
+#undef UMORSE_SYMBOL_COUNT
+
+static void _build_decode_table(void)
+{
+    static const struct {
+        char c;
+        uint16_t cw;
+    } list[] = {
+#define UMORSE_SYMBOL_ENTRY(c, cw)  { (c), (cw) },
+        UMORSE_SYMBOLS(UMORSE_SYMBOL_ENTRY)
+#undef UMORSE_SYMBOL_ENTRY
+    };
+
+    for (uint16_t mult = 1; mult != 0; mult += 2) {
+        size_t i = 0;
+        memset(umorse_decode_hash, 0, sizeof(umorse_decode_hash));
+        for (; i < sizeof(list) / sizeof(list[0]); ++i) {
+            uint32_t *e = &umorse_decode_hash[_hash(list[i].cw, mult)];
+            if (*e != 0) {
+                break;
+            }
+            *e = ((uint32_t)list[i].cw << 8) | (uint8_t)list[i].c;
+        }
+        if (i == sizeof(list) / sizeof(list[0])) {
+            umorse_decode_mult = mult;
+            return;
+        }
+    }
+    /* no perfect multiplier despite the check above, never decode garbage */
+    abort();
+}
+
+static void _init_decode_table(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_decode_table);
+}
+
+char umorse_decode_char(uint16_t cc)
+{
+    _init_decode_table();
+
+    return _lookup(cc);
 }
 
-void _process_spaces (const umorse_out_t *out, size_t spaces, uint8_t flags)
+static inline char _decode_spaces(size_t spaces)
 {
     if (spaces > 3) {
-        out->nil(out->params, 0xF | flags);
+        return '\n';
     }
     else if (spaces > 1) {
-        out->nil(out->params, 0x7 | flags);
+        return ' ';
     }
-    else if (spaces > 0) {
-        out->nil(out->params, 0x3 | flags);
+    return 0;
+}
+
+/* mask to clear the elements of a byte before a given element offset */
+static inline uint16_t _skip_mask(size_t pos, unsigned per)
+{
+    return (uint16_t)(0xFFFF << ((pos % per) * UMORSE_SHIFT));
+}
+
+/**
+ * @brief   Elements of dense code bytes as pairs of bits
+ *
+ * Every byte below UMORSE_DENSE_END holds 5 symbols in base 3, first symbol
+ * least significant, where 0 is a gap, 1 a dit and 2 a dah.
+ */
+static uint16_t umorse_dense_pairs[UMORSE_DENSE_END];
+
+static void _build_dense_pairs(void)
+{
+    for (unsigned b = 0; b < UMORSE_DENSE_END; ++b) {
+        uint16_t pairs = 0;
+        unsigned v = b;
+        for (unsigned k = 0; k < UMORSE_DENSE_ELEMS; ++k) {
+            unsigned t = v % 3;
+            pairs |= (uint16_t)((t == 0) ? UMORSE_END_CHAR : t) << (k * UMORSE_SHIFT);
+            v /= 3;
+        }
+        umorse_dense_pairs[b] = pairs;
     }
 }
 
-int umorse_output(const umorse_out_t *out,
-                  const uint8_t *code, size_t clen, uint8_t flags)
+static void _init_dense_pairs(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_dense_pairs);
+}
+
+/* elements of code byte i as pairs of bits, n is set to their number */
+static inline uint16_t _elems(const uint8_t *code, size_t clen, size_t i,
+                              uint8_t dense, unsigned *n)
+{
+    if (!dense) {
+        *n = 4;
+        return code[i];
+    }
+    if (code[i] >= UMORSE_DENSE_END) {
+        *n = 0;
+        return 0;
+    }
+    /* the end marker tells the number of symbols of the last byte */
+    *n = ((i + 1 < clen) && (code[i + 1] >= UMORSE_DENSE_END))
+         ? (unsigned)(code[i + 1] - UMORSE_DENSE_END) : UMORSE_DENSE_ELEMS;
+    return umorse_dense_pairs[code[i]];
+}
+
+/* decodes one element, returns < 0 on unknown or too long code words */
+static inline int _decode_elem(umorse_decoder_t *dec, uint8_t e,
+                               char *text, size_t tlen, size_t *tpos)
+{
+    if (e == UMORSE_NUL) {
+        return 0;
+    }
+    if (e == UMORSE_END_CHAR) {
+        if (dec->shift > 0) {
+            /* inter char gap closes the current character */
+            if ((text[(*tpos)++] = _lookup(dec->cc)) == 0) {
+                UMORSE_STATS_ADD(decode_unknown, 1);
+                return -1;
+            }
+            dec->cc = 0;
+            dec->shift = 0;
+        }
+        ++dec->spaces;
+        return 0;
+    }
+    char tc = _decode_spaces(dec->spaces);
+    dec->spaces = 0;
+    if (tc) {
+        text[(*tpos)++] = tc;
+        if (*tpos >= tlen) {
+            return 0;
+        }
+    }
+    if (dec->shift >= UMORSE_DECODE_MAX) {
+        UMORSE_STATS_ADD(decode_unknown, 1);
+        return -1;
+    }
+    dec->cc |= (uint16_t)e << (dec->shift * UMORSE_SHIFT);
+    ++dec->shift;
+    return 0;
+}
+
+void umorse_decoder_init(umorse_decoder_t *dec)
+{
+    dec->spaces = 0;
+    dec->cc = 0;
+    dec->shift = 0;
+    _init_decode_table();
+}
+
+int umorse_decoder_feed(umorse_decoder_t *dec, const uint8_t *code, size_t clen,
+                        size_t *cused, char *text, size_t tlen)
+{
+    size_t tpos = 0;
+    size_t i = 0;
+
+    /* whole bytes only, while each of its elements may emit a char */
+    for (; (i < clen) && ((tpos + UMORSE_DECODE_BYTE_MAX) <= tlen); ++i) {
+        for (unsigned j = 0; j < 4; ++j) {
+            uint8_t e = (code[i] >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (_decode_elem(dec, e, text, tlen, &tpos) < 0) {
+                return -1;
+            }
+        }
+    }
+    UMORSE_STATS_ADD(decode_calls, 1);
+    UMORSE_STATS_ADD(decode_truncated, i < clen);
+    if (cused) {
+        *cused = i;
+    }
+    return tpos;
+}
+
+int umorse_decoder_finish(umorse_decoder_t *dec, char *text, size_t tlen)
+{
+    size_t tpos = 0;
+
+    if (tlen < UMORSE_DECODE_FINISH) {
+        return -1;
+    }
+    if (dec->shift > 0) {
+        if ((text[tpos++] = _lookup(dec->cc)) == 0) {
+            UMORSE_STATS_ADD(decode_unknown, 1);
+            return -1;
+        }
+    }
+    /* drop the final stop that umorse_encode appends to close the code */
+    if (dec->spaces >= 4) {
+        dec->spaces -= 4;
+    }
+    char tc = _decode_spaces(dec->spaces);
+    if (tc) {
+        text[tpos++] = tc;
+    }
+    umorse_decoder_init(dec);
+    return tpos;
+}
+
+static inline int _decode(const uint8_t *code, size_t clen, size_t pos,
+                          uint8_t dense, char *text, size_t tlen)
+{
+    umorse_decoder_t dec;
+    size_t tpos = 0;
+    unsigned per = dense ? UMORSE_DENSE_ELEMS : 4;
+    /* elements before pos in its byte are ignored as UMORSE_NUL */
+    uint16_t mask = _skip_mask(pos, per);
+
+    umorse_decoder_init(&dec);
+    UMORSE_STATS_ADD(decode_calls, 1);
+    size_t i = pos / per;
+    for (; (i < clen) && (tpos < tlen); ++i) {
+        unsigned n;
+        uint16_t b = _elems(code, clen, i, dense, &n) & mask;
+        mask = 0xFFFF;
+        for (unsigned j = 0; (j < n) && (tpos < tlen); ++j) {
+            uint8_t e = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (_decode_elem(&dec, e, text, tlen, &tpos) < 0) {
+                return -1;
+            }
+        }
+    }
+    UMORSE_STATS_ADD(decode_truncated, i < clen);
+    if ((dec.shift > 0) && (tpos < tlen)) {
+        if ((text[tpos++] = _lookup(dec.cc)) == 0) {
+            UMORSE_STATS_ADD(decode_unknown, 1);
+            return -1;
+        }
+    }
+    /* drop the final stop that umorse_encode appends to close the code */
+    if (dec.spaces >= 4) {
+        dec.spaces -= 4;
+    }
+    char tc = _decode_spaces(dec.spaces);
+    if (tc && (tpos < tlen)) {
+        text[tpos++] = tc;
+    }
+
+    return tpos;
+}
+
+int umorse_decode(const uint8_t *code, size_t clen, char *text, size_t tlen)
+{
+    return _decode(code, clen, 0, 0, text, tlen);
+}
+
+int umorse_decode_at(const uint8_t *code, size_t clen, size_t pos,
+                     char *text, size_t tlen)
+{
+    return _decode(code, clen, pos, 0, text, tlen);
+}
+
+int umorse_decode_dense(const uint8_t *code, size_t clen, char *text, size_t tlen)
+{
+    _init_dense_pairs();
+    return _decode(code, clen, 0, 1, text, tlen);
+}
+
+static inline void _process_spaces(const umorse_out_t *out, size_t spaces,
+                                   uint8_t flags)
+{
+    uint8_t cnt = umorse_spaces_count(spaces);
+
+    if (cnt > 0) {
+        umorse_emit(out, UMORSE_SPAN_NIL | cnt, flags);
+    }
+}
+
+void umorse_timing_init(umorse_timing_t *timing, unsigned wpm, unsigned fwpm)
+{
+    assert (wpm > 0);
+
+    timing->dit = 1200000UL / wpm;
+    timing->chr = 3 * timing->dit;
+    timing->word = 7 * timing->dit;
+    timing->stop = 15 * timing->dit;
+    if (fwpm > 0 && fwpm < wpm) {
+        /* total Farnsworth delay per PARIS word, spread over 19 gap dits */
+        uint64_t delay = (60000000ULL * wpm - 37200000ULL * fwpm)
+                         / ((uint64_t)wpm * fwpm);
+        timing->chr = (uint32_t)(3 * delay / 19);
+        timing->word = (uint32_t)(7 * delay / 19);
+        timing->stop = (uint32_t)(15 * delay / 19);
+    }
+}
+
+static inline uint32_t _gap_duration(uint8_t cnt, const umorse_timing_t *timing)
+{
+    if (timing == NULL) {
+        return cnt;
+    }
+    switch (cnt) {
+        case 0xF:
+            return timing->stop;
+        case 0x7:
+            return timing->word;
+        case 0x3:
+            return timing->chr;
+        default:
+            return timing->dit;
+    }
+}
+
+int umorse_timeline(const uint8_t *code, size_t clen,
+                    umorse_key_t *keys, size_t klen,
+                    const umorse_timing_t *timing)
 {
+    size_t kpos = 0;
     size_t spaces = 0;
+    uint8_t gap = 0;
+    uint32_t dit = (timing) ? timing->dit : 1;
+
     for (size_t i = 0; i < clen; ++i) {
         for (unsigned j = 0; j < 4; ++j) {
             uint8_t cc = (code[i] >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
             if (cc == UMORSE_END_CHAR) {
                 ++spaces;
+                gap = umorse_spaces_count(spaces);
             }
             else if (cc != UMORSE_NUL) {
-                _process_spaces(out, spaces, flags);
+                if (keys && ((kpos + (gap > 0) + 1) > klen)) {
+                    return -1;
+                }
+                if (gap > 0) {
+                    if (keys) {
+                        keys[kpos] = _gap_duration(gap, timing) & UMORSE_KEY_DURATION;
+                    }
+                    ++kpos;
+                }
+                if (keys) {
+                    uint32_t d = (cc == UMORSE_DAH) ? (3 * dit) : dit;
+                    keys[kpos] = UMORSE_KEY_ON | (d & UMORSE_KEY_DURATION);
+                }
+                ++kpos;
                 spaces = 0;
-                switch (cc) {
-                    case UMORSE_DIT:
-                        out->dit(out->params, flags);
-                        out->nil(out->params, 0x1 | flags);
-                        break;
-                    case UMORSE_DAH:
-                        out->dah(out->params, flags);
-                        out->nil(out->params, 0x1 | flags);
-                        break;
-                    default:
-                        break;
+                /* gap between elements, unless a longer one follows */
+                gap = 0x1;
+            }
+        }
+    }
+    if (gap > 0) {
+        if (keys) {
+            if (kpos >= klen) {
+                return -1;
+            }
+            keys[kpos] = _gap_duration(gap, timing) & UMORSE_KEY_DURATION;
+        }
+        ++kpos;
+    }
+    return kpos;
+}
+
+static inline size_t _span_put(const umorse_out_t *out, uint8_t *span, size_t n,
+                               uint8_t e, uint8_t flags)
+{
+    span[n++] = e;
+    if (n == UMORSE_SPAN_LEN) {
+        UMORSE_STATS_ADD(output_elements, n);
+        UMORSE_STATS_CALL(UMORSE_STATS_BATCH, out->batch(out->params, span, n, flags));
+        n = 0;
+    }
+    return n;
+}
+
+static int _output_batch(const umorse_out_t *out, const uint8_t *code,
+                         size_t clen, size_t pos, uint8_t flags)
+{
+    uint8_t span[UMORSE_SPAN_LEN];
+    size_t n = 0;
+    size_t spaces = 0;
+    uint8_t dense = flags & UMORSE_FLAG_DENSE;
+    unsigned per = dense ? UMORSE_DENSE_ELEMS : 4;
+    uint16_t mask = _skip_mask(pos, per);
+
+    for (size_t i = pos / per; i < clen; ++i) {
+        unsigned cnt;
+        uint16_t b = _elems(code, clen, i, dense, &cnt) & mask;
+        mask = 0xFFFF;
+        for (unsigned j = 0; j < cnt; ++j) {
+            uint8_t cc = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (cc == UMORSE_END_CHAR) {
+                ++spaces;
+            }
+            else if (cc != UMORSE_NUL) {
+                if (spaces > 0) {
+                    n = _span_put(out, span, n,
+                                  UMORSE_SPAN_NIL | umorse_spaces_count(spaces), flags);
+                    spaces = 0;
                 }
+                n = _span_put(out, span, n, cc, flags);
+                n = _span_put(out, span, n, UMORSE_SPAN_NIL | 0x1, flags);
+            }
+        }
+    }
+    if (spaces > 0) {
+        n = _span_put(out, span, n, UMORSE_SPAN_NIL | umorse_spaces_count(spaces), flags);
+    }
+    if (n > 0) {
+        UMORSE_STATS_ADD(output_elements, n);
+        UMORSE_STATS_CALL(UMORSE_STATS_BATCH, out->batch(out->params, span, n, flags));
+    }
+    return 0;
+}
+
+int umorse_output(const umorse_out_t *out,
+                  const uint8_t *code, size_t clen, uint8_t flags)
+{
+    return umorse_output_at(out, code, clen, 0, flags);
+}
+
+int umorse_output_at(const umorse_out_t *out, const uint8_t *code,
+                     size_t clen, size_t pos, uint8_t flags)
+{
+    UMORSE_STATS_ADD(output_calls, 1);
+    if (flags & UMORSE_FLAG_DENSE) {
+        _init_dense_pairs();
+    }
+    if (out->batch) {
+        return _output_batch(out, code, clen, pos, flags);
+    }
+
+    size_t spaces = 0;
+    uint8_t dense = flags & UMORSE_FLAG_DENSE;
+    unsigned per = dense ? UMORSE_DENSE_ELEMS : 4;
+    uint16_t mask = _skip_mask(pos, per);
+    for (size_t i = pos / per; i < clen; ++i) {
+        unsigned cnt;
+        uint16_t b = _elems(code, clen, i, dense, &cnt) & mask;
+        mask = 0xFFFF;
+        for (unsigned j = 0; j < cnt; ++j) {
+            uint8_t cc = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (cc == UMORSE_END_CHAR) {
+                ++spaces;
+            }
+            else if (cc != UMORSE_NUL) {
+                _process_spaces(out, spaces, flags);
+                spaces = 0;
+                umorse_emit(out, cc, flags);
+                umorse_emit(out, UMORSE_SPAN_NIL | 0x1, flags);
             }
         }
     }
     _process_spaces(out, spaces, flags);
     return 0;
 }
+
+/**
+ * @brief   Dot-dash text of all 256 code bytes
+ *
+ * Gaps within a byte render the same regardless of context, only those at
+ * either end depend on the bytes around, so they are kept as counts.
+ */
+typedef struct {
+    char body[UMORSE_RENDER_BODY_LEN];  /**< elements and gaps in between */
+    uint8_t len;                        /**< length of body, 0 if no elements */
+    uint8_t lead;                       /**< inter char gaps before body */
+    uint8_t trail;                      /**< inter char gaps after body */
+} _render_entry_t;
+
+static _render_entry_t umorse_render_table[256];
+
+/* gap glyphs by _gap_index, padded to a fixed size copy */
+static const char umorse_render_gaps[4][UMORSE_RENDER_GAP_LEN] = {
+    "", " ", " / ", "\n"
+};
+static const uint8_t umorse_render_gaps_len[4] = { 0, 1, 3, 1 };
+
+static inline unsigned _gap_index(size_t spaces)
+{
+    if (spaces > 3) {
+        return 3;
+    }
+    else if (spaces > 1) {
+        return 2;
+    }
+    return (unsigned)spaces;
+}
+
+static void _build_render_table(void)
+{
+    for (unsigned b = 0; b < 256; ++b) {
+        _render_entry_t *entry = &umorse_render_table[b];
+        size_t spaces = 0;
+        unsigned len = 0;
+        for (unsigned j = 0; j < 4; ++j) {
+            uint8_t e = (b >> (j * UMORSE_SHIFT)) & UMORSE_MASK;
+            if (e == UMORSE_END_CHAR) {
+                ++spaces;
+            }
+            else if (e != UMORSE_NUL) {
+                if (len == 0) {
+                    entry->lead = (uint8_t)spaces;
+                }
+                else {
+                    unsigned g = _gap_index(spaces);
+                    memcpy(entry->body + len, umorse_render_gaps[g],
+                           umorse_render_gaps_len[g]);
+                    len += umorse_render_gaps_len[g];
+                }
+                entry->body[len++] = (e == UMORSE_DIT) ? '.' : '_';
+                spaces = 0;
+            }
+        }
+        if (len == 0) {
+            entry->lead = (uint8_t)spaces;
+        }
+        entry->trail = (uint8_t)spaces;
+        entry->len = (uint8_t)len;
+    }
+}
+
+static void _init_render_table(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_render_table);
+}
+
+/* renders one byte, with room for fixed size copies in text */
+static inline size_t _render_byte(size_t *spaces, uint8_t b, char *text)
+{
+    const _render_entry_t *entry = &umorse_render_table[b];
+
+    if (entry->len == 0) {
+        *spaces += entry->lead;
+        return 0;
+    }
+    unsigned g = _gap_index(*spaces + entry->lead);
+    /* surplus bytes get overwritten by the next byte */
+    memcpy(text, umorse_render_gaps[g], UMORSE_RENDER_GAP_LEN);
+    memcpy(text + umorse_render_gaps_len[g], entry->body, UMORSE_RENDER_BODY_LEN);
+    *spaces = entry->trail;
+    return umorse_render_gaps_len[g] + entry->len;
+}
+
+void umorse_renderer_init(umorse_renderer_t *r)
+{
+    r->spaces = 0;
+    _init_render_table();
+}
+
+int umorse_renderer_feed(umorse_renderer_t *r, const uint8_t *code, size_t clen,
+                         size_t *cused, char *text, size_t tlen)
+{
+    size_t tpos = 0;
+    size_t i = 0;
+
+    for (; (i < clen) && ((tpos + UMORSE_RENDER_BYTE_MAX) <= tlen); ++i) {
+        tpos += _render_byte(&r->spaces, code[i], text + tpos);
+    }
+    if (cused) {
+        *cused = i;
+    }
+    return tpos;
+}
+
+int umorse_renderer_finish(umorse_renderer_t *r, char *text, size_t tlen)
+{
+    unsigned g = _gap_index(r->spaces);
+
+    if (tlen < UMORSE_RENDER_GAP_LEN) {
+        return -1;
+    }
+    memcpy(text, umorse_render_gaps[g], umorse_render_gaps_len[g]);
+    r->spaces = 0;
+    return umorse_render_gaps_len[g];
+}
+
+int umorse_render(const uint8_t *code, size_t clen, char *text, size_t tlen)
+{
+    size_t tpos = 0;
+    size_t spaces = 0;
+
+    _init_render_table();
+    for (size_t i = 0; i < clen; ++i) {
+        if (text && ((tpos + UMORSE_RENDER_BYTE_MAX) <= tlen)) {
+            tpos += _render_byte(&spaces, code[i], text + tpos);
+            continue;
+        }
+        /* exact length near the end of text, or to query it */
+        const _render_entry_t *entry = &umorse_render_table[code[i]];
+        if (entry->len == 0) {
+            spaces += entry->lead;
+            continue;
+        }
+        unsigned g = _gap_index(spaces + entry->lead);
+        if (text) {
+            if ((tpos + umorse_render_gaps_len[g] + entry->len) > tlen) {
+                return -1;
+            }
+            memcpy(text + tpos, umorse_render_gaps[g], umorse_render_gaps_len[g]);
+            memcpy(text + tpos + umorse_render_gaps_len[g], entry->body, entry->len);
+        }
+        tpos += umorse_render_gaps_len[g] + entry->len;
+        spaces = entry->trail;
+    }
+    unsigned g = _gap_index(spaces);
+    if (text) {
+        if ((tpos + umorse_render_gaps_len[g]) > tlen) {
+            return -1;
+        }
+        memcpy(text + tpos, umorse_render_gaps[g], umorse_render_gaps_len[g]);
+    }
+    return tpos + umorse_render_gaps_len[g];
+}
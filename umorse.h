@@ -32,21 +32,6 @@
 extern "C" {
 #endif
 
-/**
- * @name Configure debugging options
- * @{
- */
-#ifndef DEBUG
-#define DEBUG                   (0)
-#endif
-
-#if DEBUG
-#define UMORSE_DEBUG(...)       printf(__VA_ARGS__)
-#else
-#define UMORSE_DEBUG(...)
-#endif
-/** @} */
-
 /**
  * @name Representation of morse code elements
  * @{
@@ -57,6 +42,7 @@ extern "C" {
 #define UMORSE_END_CHAR         (0x3)   /**< 11 */
 #define UMORSE_END_WORD         (0xF)   /**< 11 11 */
 #define UMORSE_END_STOP         (0xFF)  /**< 11 11 11 11 */
+#define UMORSE_SKIP             (0x0)   /**< input char without code word */
 /** @} */
 
 /**
@@ -69,8 +55,21 @@ extern "C" {
 #define UMORSE_LETTER_OFFSET    (65U)   /**< 'A' */
 #define UMORSE_NUMBER_OFFSET    (48U)   /**< '0' */
 #define UMORSE_FLAG_NODELAY     (0x80)
+#define UMORSE_FLAG_DENSE       (0x40)  /**< output: code is in dense mode */
+#define UMORSE_SPAN_NIL         (0x10)  /**< span entry: silent, count [0-3] */
+#ifndef UMORSE_SPAN_LEN
+#define UMORSE_SPAN_LEN         (64U)   /**< max entries per batch call */
+#endif
 
-#define UMORSE_THRESHOLD        (2U)
+#define UMORSE_THRESHOLD        (2U)    /**< max length of the final stop */
+#define UMORSE_THRESHOLD_DENSE  (3U)    /**< same, with dense end marker */
+#define UMORSE_DENSE_ELEMS      (5U)    /**< symbols per byte in dense mode */
+#define UMORSE_DENSE_END        (243U)  /**< 3^5, end marker base in dense mode */
+#define UMORSE_DECODE_BYTE_MAX  (4U)    /**< max chars decoded from one byte */
+#define UMORSE_DECODE_FINISH    (2U)    /**< max chars of umorse_decoder_finish */
+#define UMORSE_RENDER_BYTE_MAX  (12U)   /**< room to render one byte */
+#define UMORSE_DECODE_MAX       (6U)    /**< max elements per character */
+#define UMORSE_DECODE_HASH_BITS (8U)    /**< slots of the decode hash, log2 */
 /** @} */
 
 /**
@@ -79,6 +78,7 @@ extern "C" {
  */
 #define UMORSE_CODE_ALIGNED     (0x0)
 #define UMORSE_CODE_COMPACT     (0x1)
+#define UMORSE_CODE_DENSE       (0x2)
 /** @} */
 
 /**
@@ -93,11 +93,30 @@ extern "C" {
 #define UMORSE_DELAY_WORD       (7 * UMORSE_DELAY_DIT)
 /** @} */
 
+/**
+ * @name Keying timeline events
+ * @{
+ */
+#define UMORSE_KEY_ON           (0x80000000UL)  /**< key down, else key up */
+#define UMORSE_KEY_DURATION     (0x7FFFFFFFUL)  /**< mask of the duration */
+/** @} */
+
 /**
  * @brief Function pointer definition
  */
 typedef void(*umorse_fp_t)(void *args, uint8_t flags);
 
+/**
+ * @brief Batch function pointer definition
+ *
+ * Receives a span of up to UMORSE_SPAN_LEN entries, each either UMORSE_DIT,
+ * UMORSE_DAH or UMORSE_SPAN_NIL with the silent count in bits [0-3]. The
+ * entries are the same, and in the same order, as the calls umorse_output
+ * makes to dit, dah and nil otherwise.
+ */
+typedef void(*umorse_batch_fp_t)(void *args, const uint8_t *span, size_t len,
+                                 uint8_t flags);
+
 /**
  * @brief Output stream
  */
@@ -106,11 +125,66 @@ typedef struct {
     umorse_fp_t dah;    /**< function pointer to output a morse dah */
     umorse_fp_t nil;    /**< function pointer to output a morse silent */
     void *params;       /**< stores common parameters for output functions */
+    umorse_batch_fp_t batch;    /**< optional, replaces dit, dah and nil */
 } umorse_out_t;
 
+/**
+ * @brief   Keying event, level in UMORSE_KEY_ON and duration in the rest
+ */
+typedef uint32_t umorse_key_t;
+
+/**
+ * @brief   Durations of the keying timeline, in a unit of choice
+ */
+typedef struct {
+    uint32_t dit;       /**< dit and gap between elements, dah is 3 dits */
+    uint32_t chr;       /**< gap between characters */
+    uint32_t word;      /**< gap between words */
+    uint32_t stop;      /**< gap of a stop */
+} umorse_timing_t;
+
+/**
+ * @brief   State of an incremental encoder
+ */
+typedef struct {
+    uint64_t acc;       /**< pending compact elements or dense symbols */
+    uint8_t bits;       /**< number of valid bits, or symbols, in acc */
+    uint8_t flags;      /**< encoding flags, see umorse_encode */
+} umorse_encoder_t;
+
+/**
+ * @brief   State of an incremental decoder
+ */
+typedef struct {
+    size_t spaces;      /**< inter char gaps since the last element */
+    uint16_t cc;        /**< code word of the current character */
+    uint8_t shift;      /**< number of elements in cc */
+} umorse_decoder_t;
+
+/**
+ * @brief   State of an incremental dot-dash renderer
+ */
+typedef struct {
+    size_t spaces;      /**< inter char gaps since the last element */
+} umorse_renderer_t;
+
 /**
  * @brief   Encodes a given sting into morse code
  *
+ * Letters, numbers, punctuation and prosigns of symbols.h are encoded,
+ * blanks as word gaps and other control chars as stops; any other byte is
+ * ignored. The output buffer is only written, never read, so it needs no
+ * initialization. The returned length covers exactly the bytes written,
+ * including the final stop that closes the code. If the output buffer is
+ * too small, the input is truncated at a character boundary; use the
+ * umorse_encoder_* functions to encode input in chunks instead.
+ *
+ * With UMORSE_CODE_DENSE, dits, dahs and gaps are packed as base 3 symbols,
+ * 5 per byte, which is about 20% smaller than compact mode. The last byte is
+ * followed by an end marker, UMORSE_DENSE_END plus the number of symbols in
+ * the last byte. Dense code is decoded with umorse_decode_dense and output
+ * with UMORSE_FLAG_DENSE.
+ *
  * @param[in]   text    Input text string
  * @param[in]   tlen    Length of input string
  * @param[out]  code    Output buffer for encoded text
@@ -157,9 +231,123 @@ int umorse_encode_aligned(const char *text, size_t tlen,
 int umorse_encode_compact(const char *text, size_t tlen,
                           uint8_t *code, size_t clen);
 
+/**
+ * @brief   Encodes a given sting into morse code in dense mode
+ *
+ * @note    This is a short hand function calling umorse_encode with flags
+ *          set to UMORSE_CODE_DENSE.
+ *
+ * @param[in]   text    Input text string
+ * @param[in]   tlen    Length of input string
+ * @param[out]  code    Output buffer for encoded text
+ * @param[in]   clen    Length of output buffer
+ *
+ * @returns     lenght of bytes written to output buffer
+ * @returns     < 0 on error
+ */
+int umorse_encode_dense(const char *text, size_t tlen,
+                        uint8_t *code, size_t clen);
+
+/**
+ * @brief   Returns the number of bits a given string occupies in morse code
+ *
+ * Covers the characters only, without the final stop. As the bit length of
+ * concatenated strings is the sum of their bit lengths, this allows to find
+ * the output offset of any part of a larger input. Not defined for dense
+ * mode, where symbols do not map to bits.
+ *
+ * @param[in]   text    Input text string
+ * @param[in]   tlen    Length of input string
+ * @param[in]   flags   Optional flags, see umorse_encode
+ *
+ * @returns     number of bits, a multiple of 8 in aligned mode
+ */
+uint64_t umorse_encode_bits(const char *text, size_t tlen, uint8_t flags);
+
+/**
+ * @brief   Returns the exact length of the code umorse_encode produces
+ *
+ * @note    umorse_encode keeps UMORSE_THRESHOLD bytes for the final stop, so
+ *          the output buffer may need one byte more to avoid truncation.
+ *
+ * @param[in]   text    Input text string
+ * @param[in]   tlen    Length of input string
+ * @param[in]   flags   Optional flags, see umorse_encode
+ *
+ * @returns     length of bytes, including the final stop
+ */
+size_t umorse_encode_len(const char *text, size_t tlen, uint8_t flags);
+
+/**
+ * @brief   Initializes an incremental encoder
+ *
+ * @param[out]  enc     Encoder state
+ * @param[in]   flags   Optional flags, see umorse_encode
+ */
+void umorse_encoder_init(umorse_encoder_t *enc, uint8_t flags);
+
+/**
+ * @brief   Encodes the next chunk of input text
+ *
+ * Encodes as many whole characters as fit into the output buffer. In compact
+ * mode the elements of an unfinished byte are kept in @p enc and written by
+ * the next call, so consecutive outputs concatenate to the same code
+ * umorse_encode produces. The output buffer needs no initialization.
+ *
+ * @param[in,out]   enc     Encoder state
+ * @param[in]       text    Input text chunk
+ * @param[in]       tlen    Length of input text chunk
+ * @param[out]      tused   Number of input bytes consumed, may be NULL
+ * @param[out]      code    Output buffer for encoded text
+ * @param[in]       clen    Length of output buffer
+ *
+ * @returns     length of bytes written to output buffer
+ */
+int umorse_encoder_feed(umorse_encoder_t *enc, const char *text, size_t tlen,
+                        size_t *tused, uint8_t *code, size_t clen);
+
+/**
+ * @brief   Encodes a single code word, e.g. of a character outside ASCII
+ *
+ * Writes @p cc followed by the inter char gap, exactly as
+ * umorse_encoder_feed writes an input char with that code word.
+ *
+ * @param[in,out]   enc     Encoder state
+ * @param[in]       cc      Code word, elements packed from LSB onwards
+ * @param[out]      code    Output buffer for encoded text
+ * @param[in]       clen    Length of output buffer
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 if the code word does not fit, @p enc is unchanged
+ */
+int umorse_encoder_put(umorse_encoder_t *enc, uint16_t cc,
+                       uint8_t *code, size_t clen);
+
+/**
+ * @brief   Writes pending elements and the final stop, resets the encoder
+ *
+ * @param[in,out]   enc     Encoder state
+ * @param[out]      code    Output buffer for encoded text
+ * @param[in]       clen    Length of output buffer, at least UMORSE_THRESHOLD,
+ *                          or UMORSE_THRESHOLD_DENSE in dense mode
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 if the output buffer is too small, @p enc is unchanged
+ */
+int umorse_encoder_finish(umorse_encoder_t *enc, uint8_t *code, size_t clen);
+
 /**
  * @brief   Decodes a given morse code into a text string
  *
+ * Accepts both aligned and compact code, as produced by umorse_encode. Each
+ * character is resolved with a single lookup of its packed code word; an
+ * inter char gap separates characters, a word gap decodes to ' ' and a stop
+ * to '\n'. The output is not NUL terminated and truncated to @p tlen.
+ *
+ * @note    Target throughput is at least 20 million characters per second
+ *          on a desktop class CPU, measured with the round-trip test in
+ *          tests/main.c.
+ *
  * @param[in]   code    Input buffer with encoded text
  * @param[in]   clen    Length of input buffer
  * @param[out]  text    Ouptut for decoded text string
@@ -170,9 +358,134 @@ int umorse_encode_compact(const char *text, size_t tlen,
  */
 int umorse_decode(const uint8_t *code, size_t clen, char *text, size_t tlen);
 
+/**
+ * @brief   Decodes morse code starting at a given element
+ *
+ * @see     umorse_decode, umorse_index_seek to find the element of a char
+ *
+ * @param[in]   code    Input buffer with encoded text
+ * @param[in]   clen    Length of input buffer
+ * @param[in]   pos     Offset of first element to decode, in pairs of bits
+ * @param[out]  text    Ouptut for decoded text string
+ * @param[in]   tlen    Length of output string buffer
+ *
+ * @returns     lenght of bytes written to output buffer
+ * @returns     < 0 on error
+ */
+int umorse_decode_at(const uint8_t *code, size_t clen, size_t pos,
+                     char *text, size_t tlen);
+
+/**
+ * @brief   Decodes morse code in dense mode into a text string
+ *
+ * @see     umorse_decode
+ *
+ * @param[in]   code    Input buffer with encoded text
+ * @param[in]   clen    Length of input buffer
+ * @param[out]  text    Ouptut for decoded text string
+ * @param[in]   tlen    Length of output string buffer
+ *
+ * @returns     lenght of bytes written to output buffer
+ * @returns     < 0 on error
+ */
+int umorse_decode_dense(const uint8_t *code, size_t clen, char *text, size_t tlen);
+
+/**
+ * @brief   Initializes an incremental decoder
+ *
+ * @param[out]  dec     Decoder state
+ */
+void umorse_decoder_init(umorse_decoder_t *dec);
+
+/**
+ * @brief   Decodes the next chunk of morse code
+ *
+ * Decodes whole bytes of code, as long as the output buffer has room for
+ * UMORSE_DECODE_BYTE_MAX chars. Characters and gaps spanning chunks are kept
+ * in @p dec, so consecutive outputs concatenate to the same text
+ * umorse_decode produces.
+ *
+ * @param[in,out]   dec     Decoder state
+ * @param[in]       code    Input chunk of encoded text
+ * @param[in]       clen    Length of input chunk
+ * @param[out]      cused   Number of input bytes consumed, may be NULL
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 on unknown or too long code words
+ */
+int umorse_decoder_feed(umorse_decoder_t *dec, const uint8_t *code, size_t clen,
+                        size_t *cused, char *text, size_t tlen);
+
+/**
+ * @brief   Writes the pending character and gap, resets the decoder
+ *
+ * The final stop that umorse_encode appends is dropped.
+ *
+ * @param[in,out]   dec     Decoder state
+ * @param[out]      text    Output for decoded text
+ * @param[in]       tlen    Length of output buffer, at least
+ *                          UMORSE_DECODE_FINISH
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 on error
+ */
+int umorse_decoder_finish(umorse_decoder_t *dec, char *text, size_t tlen);
+
+/**
+ * @brief   Looks up the character of a single code word
+ *
+ * @param[in]   cc      Elements of one character, packed from LSB onwards as
+ *                      in umorse_encode, without the inter char gap
+ *
+ * @returns     the character, or 0 if @p cc is no valid code word
+ */
+char umorse_decode_char(uint16_t cc);
+
+/**
+ * @brief   Sets timing in micro seconds for a given speed
+ *
+ * Uses the PARIS standard, i.e. a dit lasts 1200/@p wpm milli seconds. With
+ * Farnsworth timing, characters are sent at @p wpm but the gaps between
+ * characters and words are stretched to reach an overall speed of @p fwpm.
+ *
+ * @param[out]  timing  Timing to initialize
+ * @param[in]   wpm     Character speed in words per minute, > 0
+ * @param[in]   fwpm    Overall speed in words per minute, 0 or >= wpm to
+ *                      disable Farnsworth timing
+ */
+void umorse_timing_init(umorse_timing_t *timing, unsigned wpm, unsigned fwpm);
+
+/**
+ * @brief   Renders morse code into a timeline of keying events
+ *
+ * Consecutive gaps, i.e. the gap after an element and the gaps between
+ * characters and words, are merged into a single key up event of the
+ * longest of them. This is standard Morse timing, where a character gap
+ * lasts 3 dits in total.
+ *
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ * @param[out]  keys    Output buffer for events, may be NULL
+ * @param[in]   klen    Length of output buffer in events
+ * @param[in]   timing  Durations of elements and gaps, NULL for dit units
+ *                      (1, 3, 7 and 15 dits)
+ *
+ * @returns     number of events written, or required if @p keys is NULL
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_timeline(const uint8_t *code, size_t clen,
+                    umorse_key_t *keys, size_t klen,
+                    const umorse_timing_t *timing);
+
 /**
  * @brief   Outputs an morse encoded string using a given output interface
  *
+ * If @p out provides a batch function, elements are passed on in spans to
+ * save one indirect call per element, otherwise dit, dah and nil are called.
+ * Set UMORSE_FLAG_DENSE in @p flags for code in dense mode.
+ *
  * @param[in]   out     Interface or device to output morse encoded buffer
  * @param[in]   code    Buffer with morse encoded text
  * @param[in]   clen    Length of morse encoded text
@@ -184,9 +497,223 @@ int umorse_decode(const uint8_t *code, size_t clen, char *text, size_t tlen);
 int umorse_output(const umorse_out_t *out,
                   const uint8_t *code, size_t clen, uint8_t flags);
 
+/**
+ * @brief   Outputs morse code starting at a given element
+ *
+ * @see     umorse_output, umorse_index_seek to find the element of a char
+ *
+ * @param[in]   out     Interface or device to output morse encoded buffer
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ * @param[in]   pos     Offset of first element to output, in pairs of bits
+ *                      or, in dense mode, in symbols
+ * @param[in]   flags   Pass optional params, with [0-3]=count and [4-7]=flags
+ *
+ * @returns     0 or >0 on success
+ * @returns     <0 on error
+ */
+int umorse_output_at(const umorse_out_t *out, const uint8_t *code,
+                     size_t clen, size_t pos, uint8_t flags);
+
+/**
+ * @brief   Renders morse code as dot-dash text into a given buffer
+ *
+ * Uses the glyphs of umorse_print_*: '.' and '_' for dit and dah, ' '
+ * between chars, " / " between words and '\n' for a stop. Each byte of code
+ * is rendered from a precomputed table, no stdio is involved. The output is
+ * not NUL terminated.
+ *
+ * @param[in]   code    Buffer with morse encoded text
+ * @param[in]   clen    Length of morse encoded text
+ * @param[out]  text    Output buffer for rendered text, may be NULL
+ * @param[in]   tlen    Length of output buffer
+ *
+ * @returns     length of bytes written, or required if @p text is NULL
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_render(const uint8_t *code, size_t clen, char *text, size_t tlen);
+
+/**
+ * @brief   Initializes an incremental renderer
+ *
+ * @param[out]  r       Renderer state
+ */
+void umorse_renderer_init(umorse_renderer_t *r);
+
+/**
+ * @brief   Renders the next chunk of morse code as dot-dash text
+ *
+ * Renders whole bytes of code, as long as the output buffer has room for
+ * UMORSE_RENDER_BYTE_MAX chars. Gaps spanning chunks are kept in @p r, so
+ * consecutive outputs concatenate to the same text umorse_render produces.
+ *
+ * @param[in,out]   r       Renderer state
+ * @param[in]       code    Input chunk of encoded text
+ * @param[in]       clen    Length of input chunk
+ * @param[out]      cused   Number of input bytes consumed, may be NULL
+ * @param[out]      text    Output buffer for rendered text
+ * @param[in]       tlen    Length of output buffer
+ *
+ * @returns     length of bytes written to output buffer
+ */
+int umorse_renderer_feed(umorse_renderer_t *r, const uint8_t *code, size_t clen,
+                         size_t *cused, char *text, size_t tlen);
+
+/**
+ * @brief   Writes the pending gap, resets the renderer
+ *
+ * @param[in,out]   r       Renderer state
+ * @param[out]      text    Output buffer for rendered text
+ * @param[in]       tlen    Length of output buffer, at least 4
+ *
+ * @returns     length of bytes written to output buffer
+ * @returns     < 0 if the output buffer is too small
+ */
+int umorse_renderer_finish(umorse_renderer_t *r, char *text, size_t tlen);
+
 #ifdef __cplusplus
 }
 #endif
 
+#if defined(__cplusplus) && (__cplusplus >= 201402L)
+#include "symbols.h"
+
+/**
+ * @brief   Compile-time encoding of constant text, C++14 and later
+ *
+ * Encodes a string literal exactly as umorse_encode does, given a buffer
+ * large enough, into a constexpr array that can live in read only memory
+ * and be passed to umorse_output as is:
+ *
+ *     static constexpr auto sos = UMORSE_CODE("SOS", UMORSE_CODE_ALIGNED);
+ *     umorse_output(&out, sos.data, sos.size(), 0);
+ *
+ * Dense mode is not supported.
+ */
+namespace umorse {
+
+/**
+ * @brief   Code array of a fixed length
+ */
+template <size_t N>
+struct code {
+    uint8_t data[N];    /**< encoded text, including the final stop */
+
+    /** @brief  Length of code in bytes */
+    constexpr size_t size() const { return N; }
+};
+
+namespace detail {
+
+/* same classification as the runtime encoder */
+constexpr uint16_t classify(char c)
+{
+    if ((c == ' ') || (c == '\t')) {
+        return UMORSE_END_WORD;
+    }
+    if ((c > 0) && (c < ' ')) {
+        return UMORSE_END_STOP;
+    }
+    if ((c >= 'a') && (c <= 'z')) {
+        c = (char)(c - 32);
+    }
+    switch (c) {
+#define UMORSE_SYMBOL_CASE(chr, cw)     case (chr): return (cw);
+        UMORSE_SYMBOLS(UMORSE_SYMBOL_CASE)
+#undef UMORSE_SYMBOL_CASE
+        default:
+            return UMORSE_SKIP;
+    }
+}
+
+/* number of elements of a code word, plus the inter char gap */
+constexpr unsigned elems(uint16_t cc)
+{
+    unsigned n = 0;
+
+    while (cc >> (n * UMORSE_SHIFT)) {
+        ++n;
+    }
+    return ((cc == UMORSE_SKIP) || ((cc & UMORSE_MASK) == UMORSE_END_CHAR)) ? n : n + 1;
+}
+
+/* number of bytes of a code word in aligned mode */
+constexpr unsigned bytes(uint16_t cc)
+{
+    return (cc == UMORSE_SKIP) ? 0
+         : 1 + (cc > 0xFF) + ((cc & UMORSE_MASK) != UMORSE_END_CHAR);
+}
+
+} /* namespace detail */
+
+/**
+ * @brief   Length of code of a string literal, as umorse_encode_len
+ */
+template <size_t N>
+constexpr size_t encode_len(const char (&text)[N], uint8_t flags)
+{
+    size_t cnt = 0;
+
+    for (size_t i = 0; i + 1 < N; ++i) {
+        uint16_t cc = detail::classify(text[i]);
+        cnt += (flags & UMORSE_CODE_COMPACT) ? detail::elems(cc) : detail::bytes(cc);
+    }
+    if (flags & UMORSE_CODE_COMPACT) {
+        return ((cnt + 4) * UMORSE_SHIFT + 7) / 8;
+    }
+    return cnt + 1;
+}
+
+/**
+ * @brief   Encodes a string literal, use UMORSE_CODE for the length
+ */
+template <size_t L, size_t N>
+constexpr code<L> encode(const char (&text)[N], uint8_t flags)
+{
+    code<L> res{};
+    size_t pos = 0;
+
+    if (flags & UMORSE_CODE_COMPACT) {
+        for (size_t i = 0; i + 1 < N; ++i) {
+            uint16_t cc = detail::classify(text[i]);
+            unsigned n = detail::elems(cc);
+            for (unsigned k = 0; k < n; ++k, ++pos) {
+                /* the element beyond the code word is the gap */
+                uint8_t e = (cc >> (k * UMORSE_SHIFT)) & UMORSE_MASK;
+                e = (e == UMORSE_NUL) ? UMORSE_END_CHAR : e;
+                res.data[pos / 4] |= (uint8_t)(e << ((pos % 4) * UMORSE_SHIFT));
+            }
+        }
+        for (unsigned k = 0; k < 4; ++k, ++pos) {
+            res.data[pos / 4] |= (uint8_t)(UMORSE_END_CHAR << ((pos % 4) * UMORSE_SHIFT));
+        }
+        return res;
+    }
+    for (size_t i = 0; i + 1 < N; ++i) {
+        uint16_t cc = detail::classify(text[i]);
+        if (cc == UMORSE_SKIP) {
+            continue;
+        }
+        res.data[pos++] = (uint8_t)(cc & 0xFF);
+        if (cc > 0xFF) {
+            res.data[pos++] = (uint8_t)(cc >> 8);
+        }
+        if ((cc & UMORSE_MASK) != UMORSE_END_CHAR) {
+            res.data[pos++] = UMORSE_END_CHAR;
+        }
+    }
+    res.data[pos] = UMORSE_END_STOP;
+    return res;
+}
+
+} /* namespace umorse */
+
+/**
+ * @brief   Encodes a string literal at compile time, see umorse::encode
+ */
+#define UMORSE_CODE(text, flags) \
+    ::umorse::encode<::umorse::encode_len(text, flags)>(text, flags)
+#endif
+
 #endif /* UMORSE_H */
 /** @} */
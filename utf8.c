@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Implementation of a uMorse encoder for UTF-8 text
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ * @}
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "once.h"
+#include "umorse.h"
+#include "utf8.h"
+
+/* code points below are looked up, all alphabets fit */
+#define UMORSE_UTF8_MAX         (0x3100U)
+/* code points per block of the second table level */
+#define UMORSE_UTF8_BLOCK_BITS  (6U)
+#define UMORSE_UTF8_BLOCK_LEN   (1U << UMORSE_UTF8_BLOCK_BITS)
+/* blocks in use, 2 Greek, 2 Cyrillic and 4 kana */
+#define UMORSE_UTF8_BLOCKS      (8U)
+
+/* trailing sign of an entry, in bits 12-13 above the code word */
+#define UMORSE_UTF8_DAKUTEN     (1U)
+#define UMORSE_UTF8_HANDAKUTEN  (2U)
+#define UMORSE_UTF8_MARK_SHIFT  (12U)
+#define UMORSE_UTF8_CW_MASK     ((1U << UMORSE_UTF8_MARK_SHIFT) - 1)
+
+/* high bit of every byte, any set marks a non ASCII byte */
+#define UMORSE_UTF8_HI          (0x8080808080808080ULL)
+
+/**
+ * @brief   Two level lookup of code points to code words
+ *
+ * The index maps each block of 64 code points to its row of code words,
+ * row 0 is empty and shared by all blocks without any. Each block belongs
+ * to a single alphabet, such that the selection is one compare per lookup.
+ */
+static uint8_t umorse_utf8_index[UMORSE_UTF8_MAX >> UMORSE_UTF8_BLOCK_BITS];
+static uint16_t umorse_utf8_codes[UMORSE_UTF8_BLOCKS + 1][UMORSE_UTF8_BLOCK_LEN];
+static uint8_t umorse_utf8_alphabet[UMORSE_UTF8_BLOCKS + 1];
+static unsigned umorse_utf8_blocks;
+
+/* code words of the signs, indexed by the mark of an entry */
+static uint16_t umorse_utf8_marks[4];
+
+/* Greek from U+0391, upper case, U+03A2 is unassigned */
+static const char *const umorse_greek[] = {
+    ".-",    "-...",  "--.",   "-..",   ".",     "--..",  "....",  "-.-.",
+    "..",    "-.-",   ".-..",  "--",    "-.",    "-..-",  "---",   ".--.",
+    ".-.",   NULL,    "...",   "-",     "-.--",  "..-.",  "----",  "--.-",
+    ".--",
+};
+
+/* Cyrillic from U+0410, upper case */
+static const char *const umorse_cyrillic[] = {
+    ".-",    "-...",  ".--",   "--.",   "-..",   ".",     "...-",  "--..",
+    "..",    ".---",  "-.-",   ".-..",  "--",    "-.",    "---",   ".--.",
+    ".-.",   "...",   "-",     "..-",   "..-.",  "....",  "-.-.",  "---.",
+    "----",  "--.-",  "--.--", "-.--",  "-..-",  "..-..", "..--",  ".-.-",
+};
+
+/* Wabun from U+30A1, small kana are sent as the normal ones */
+static const struct {
+    const char *code;
+    uint8_t mark;
+} umorse_kana[] = {
+    { "--.--",  0                        },  /* small a */
+    { "--.--",  0                        },  /* a */
+    { ".-",     0                        },  /* small i */
+    { ".-",     0                        },  /* i */
+    { "..-",    0                        },  /* small u */
+    { "..-",    0                        },  /* u */
+    { "-.---",  0                        },  /* small e */
+    { "-.---",  0                        },  /* e */
+    { ".-...",  0                        },  /* small o */
+    { ".-...",  0                        },  /* o */
+    { ".-..",   0                        },  /* ka */
+    { ".-..",   UMORSE_UTF8_DAKUTEN      },  /* ga */
+    { "-.-..",  0                        },  /* ki */
+    { "-.-..",  UMORSE_UTF8_DAKUTEN      },  /* gi */
+    { "...-",   0                        },  /* ku */
+    { "...-",   UMORSE_UTF8_DAKUTEN      },  /* gu */
+    { "-.--",   0                        },  /* ke */
+    { "-.--",   UMORSE_UTF8_DAKUTEN      },  /* ge */
+    { "----",   0                        },  /* ko */
+    { "----",   UMORSE_UTF8_DAKUTEN      },  /* go */
+    { "-.-.-",  0                        },  /* sa */
+    { "-.-.-",  UMORSE_UTF8_DAKUTEN      },  /* za */
+    { "--.-.",  0                        },  /* si */
+    { "--.-.",  UMORSE_UTF8_DAKUTEN      },  /* zi */
+    { "---.-",  0                        },  /* su */
+    { "---.-",  UMORSE_UTF8_DAKUTEN      },  /* zu */
+    { ".---.",  0                        },  /* se */
+    { ".---.",  UMORSE_UTF8_DAKUTEN      },  /* ze */
+    { "---.",   0                        },  /* so */
+    { "---.",   UMORSE_UTF8_DAKUTEN      },  /* zo */
+    { "-.",     0                        },  /* ta */
+    { "-.",     UMORSE_UTF8_DAKUTEN      },  /* da */
+    { "..-.",   0                        },  /* ti */
+    { "..-.",   UMORSE_UTF8_DAKUTEN      },  /* di */
+    { ".--.",   0                        },  /* small tu */
+    { ".--.",   0                        },  /* tu */
+    { ".--.",   UMORSE_UTF8_DAKUTEN      },  /* du */
+    { ".-.--",  0                        },  /* te */
+    { ".-.--",  UMORSE_UTF8_DAKUTEN      },  /* de */
+    { "..-..",  0                        },  /* to */
+    { "..-..",  UMORSE_UTF8_DAKUTEN      },  /* do */
+    { ".-.",    0                        },  /* na */
+    { "-.-.",   0                        },  /* ni */
+    { "....",   0                        },  /* nu */
+    { "--.-",   0                        },  /* ne */
+    { "..--",   0                        },  /* no */
+    { "-...",   0                        },  /* ha */
+    { "-...",   UMORSE_UTF8_DAKUTEN      },  /* ba */
+    { "-...",   UMORSE_UTF8_HANDAKUTEN   },  /* pa */
+    { "--..-",  0                        },  /* hi */
+    { "--..-",  UMORSE_UTF8_DAKUTEN      },  /* bi */
+    { "--..-",  UMORSE_UTF8_HANDAKUTEN   },  /* pi */
+    { "--..",   0                        },  /* hu */
+    { "--..",   UMORSE_UTF8_DAKUTEN      },  /* bu */
+    { "--..",   UMORSE_UTF8_HANDAKUTEN   },  /* pu */
+    { ".",      0                        },  /* he */
+    { ".",      UMORSE_UTF8_DAKUTEN      },  /* be */
+    { ".",      UMORSE_UTF8_HANDAKUTEN   },  /* pe */
+    { "-..",    0                        },  /* ho */
+    { "-..",    UMORSE_UTF8_DAKUTEN      },  /* bo */
+    { "-..",    UMORSE_UTF8_HANDAKUTEN   },  /* po */
+    { "-..-",   0                        },  /* ma */
+    { "..-.-",  0                        },  /* mi */
+    { "-",      0                        },  /* mu */
+    { "-...-",  0                        },  /* me */
+    { "-..-.",  0                        },  /* mo */
+    { ".--",    0                        },  /* small ya */
+    { ".--",    0                        },  /* ya */
+    { "-..--",  0                        },  /* small yu */
+    { "-..--",  0                        },  /* yu */
+    { "--",     0                        },  /* small yo */
+    { "--",     0                        },  /* yo */
+    { "...",    0                        },  /* ra */
+    { "--.",    0                        },  /* ri */
+    { "-.--.",  0                        },  /* ru */
+    { "---",    0                        },  /* re */
+    { ".-.-",   0                        },  /* ro */
+    { "-.-",    0                        },  /* small wa */
+    { "-.-",    0                        },  /* wa */
+    { ".-..-",  0                        },  /* wi */
+    { ".--..",  0                        },  /* we */
+    { ".---",   0                        },  /* wo */
+    { ".-.-.",  0                        },  /* n */
+    { "..-",    UMORSE_UTF8_DAKUTEN      },  /* vu */
+};
+
+/* packs dits and dahs given as '.' and '-' into a code word */
+static uint16_t _parse(const char *code)
+{
+    uint16_t cw = 0;
+
+    for (unsigned i = 0; code[i] != '\0'; ++i) {
+        uint16_t e = (code[i] == '.') ? UMORSE_DIT : UMORSE_DAH;
+        cw |= e << (i * UMORSE_SHIFT);
+    }
+    return cw;
+}
+
+static void _set(uint32_t cp, uint16_t entry, uint8_t alphabet)
+{
+    uint8_t *row = &umorse_utf8_index[cp >> UMORSE_UTF8_BLOCK_BITS];
+
+    if (*row == 0) {
+        assert (umorse_utf8_blocks < UMORSE_UTF8_BLOCKS);
+        *row = (uint8_t)(++umorse_utf8_blocks);
+        umorse_utf8_alphabet[*row] = alphabet;
+    }
+    assert (umorse_utf8_alphabet[*row] == alphabet);
+    umorse_utf8_codes[*row][cp & (UMORSE_UTF8_BLOCK_LEN - 1)] = entry;
+}
+
+static void _build_tables(void)
+{
+    for (unsigned i = 0; i < sizeof(umorse_greek) / sizeof(umorse_greek[0]); ++i) {
+        if (umorse_greek[i]) {
+            _set(0x0391 + i, _parse(umorse_greek[i]), UMORSE_ALPHABET_GREEK);
+            _set(0x03B1 + i, _parse(umorse_greek[i]), UMORSE_ALPHABET_GREEK);
+        }
+    }
+    /* final sigma */
+    _set(0x03C2, _parse("..."), UMORSE_ALPHABET_GREEK);
+    for (unsigned i = 0; i < sizeof(umorse_cyrillic) / sizeof(umorse_cyrillic[0]); ++i) {
+        _set(0x0410 + i, _parse(umorse_cyrillic[i]), UMORSE_ALPHABET_CYRILLIC);
+        _set(0x0430 + i, _parse(umorse_cyrillic[i]), UMORSE_ALPHABET_CYRILLIC);
+    }
+    /* io, sent as ie */
+    _set(0x0401, _parse("."), UMORSE_ALPHABET_CYRILLIC);
+    _set(0x0451, _parse("."), UMORSE_ALPHABET_CYRILLIC);
+    for (unsigned i = 0; i < sizeof(umorse_kana) / sizeof(umorse_kana[0]); ++i) {
+        uint16_t entry = _parse(umorse_kana[i].code)
+                         | (umorse_kana[i].mark << UMORSE_UTF8_MARK_SHIFT);
+        /* katakana and the same hiragana 0x60 below */
+        _set(0x30A1 + i, entry, UMORSE_ALPHABET_WABUN);
+        _set(0x3041 + i, entry, UMORSE_ALPHABET_WABUN);
+    }
+    umorse_utf8_marks[UMORSE_UTF8_DAKUTEN] = _parse("..");
+    umorse_utf8_marks[UMORSE_UTF8_HANDAKUTEN] = _parse("..--.");
+    /* combining and spacing signs on their own */
+    _set(0x3099, umorse_utf8_marks[UMORSE_UTF8_DAKUTEN], UMORSE_ALPHABET_WABUN);
+    _set(0x309A, umorse_utf8_marks[UMORSE_UTF8_HANDAKUTEN], UMORSE_ALPHABET_WABUN);
+    _set(0x309B, umorse_utf8_marks[UMORSE_UTF8_DAKUTEN], UMORSE_ALPHABET_WABUN);
+    _set(0x309C, umorse_utf8_marks[UMORSE_UTF8_HANDAKUTEN], UMORSE_ALPHABET_WABUN);
+    /* long vowel, ideographic comma, full stop, brackets and space */
+    _set(0x30FC, _parse(".--.-"), UMORSE_ALPHABET_WABUN);
+    _set(0x3001, _parse(".-.-.-"), UMORSE_ALPHABET_WABUN);
+    _set(0x3002, _parse(".-.-.."), UMORSE_ALPHABET_WABUN);
+    _set(0x300C, _parse("-.--.-"), UMORSE_ALPHABET_WABUN);
+    _set(0x300D, _parse(".-..-."), UMORSE_ALPHABET_WABUN);
+    _set(0x3000, UMORSE_END_WORD, UMORSE_ALPHABET_WABUN);
+}
+
+static void _init_tables(void)
+{
+    static umorse_once_t once = UMORSE_ONCE_INIT;
+
+    UMORSE_ONCE(&once, _build_tables);
+}
+
+static inline uint16_t _lookup(uint32_t cp, uint8_t alphabets, uint16_t *mark)
+{
+    unsigned row = (cp < UMORSE_UTF8_MAX) ? umorse_utf8_index[cp >> UMORSE_UTF8_BLOCK_BITS] : 0;
+    uint16_t entry = (umorse_utf8_alphabet[row] & alphabets)
+                     ? umorse_utf8_codes[row][cp & (UMORSE_UTF8_BLOCK_LEN - 1)] : 0;
+
+    *mark = umorse_utf8_marks[entry >> UMORSE_UTF8_MARK_SHIFT];
+    return entry & UMORSE_UTF8_CW_MASK;
+}
+
+uint16_t umorse_utf8_lookup(uint32_t cp, uint8_t alphabets, uint16_t *mark)
+{
+    uint16_t tmp;
+
+    _init_tables();
+    return _lookup(cp, alphabets, mark ? mark : &tmp);
+}
+
+/* length of the leading run of ASCII bytes, 8 bytes at a time */
+static inline size_t _ascii_run(const char *text, size_t tlen)
+{
+    size_t i = 0;
+
+    for (; (i + 8) <= tlen; i += 8) {
+        uint64_t w;
+        memcpy(&w, text + i, sizeof(w));
+        if (w & UMORSE_UTF8_HI) {
+            break;
+        }
+    }
+    while ((i < tlen) && !(text[i] & 0x80)) {
+        ++i;
+    }
+    return i;
+}
+
+/**
+ * @brief   Decodes the multibyte sequence at the start of @p text
+ *
+ * An invalid sequence yields a code point above U+10FFFF and its length
+ * up to the first offending byte, such that decoding resumes right there.
+ *
+ * @returns     number of bytes consumed, at least 1
+ */
+static inline size_t _next(const uint8_t *text, size_t tlen, uint32_t *cp)
+{
+    uint8_t c = text[0];
+    uint32_t v;
+    uint32_t min;
+    size_t n;
+
+    *cp = UINT32_MAX;
+    if ((c >= 0xC2) && (c <= 0xDF)) {
+        v = c & 0x1F;
+        min = 0x80;
+        n = 2;
+    }
+    else if ((c >= 0xE0) && (c <= 0xEF)) {
+        v = c & 0x0F;
+        min = 0x800;
+        n = 3;
+    }
+    else if ((c >= 0xF0) && (c <= 0xF4)) {
+        v = c & 0x07;
+        min = 0x10000;
+        n = 4;
+    }
+    else {
+        /* stray continuation, overlong lead or out of range */
+        return 1;
+    }
+    for (size_t i = 1; i < n; ++i) {
+        if ((i >= tlen) || ((text[i] & 0xC0) != 0x80)) {
+            return i;
+        }
+        v = (v << 6) | (text[i] & 0x3F);
+    }
+    if ((v >= min) && (v <= 0x10FFFF) && ((v < 0xD800) || (v > 0xDFFF))) {
+        *cp = v;
+    }
+    return n;
+}
+
+int umorse_utf8_encode(const char *text, size_t tlen, uint8_t *code,
+                       size_t clen, uint8_t flags, uint8_t alphabets)
+{
+    size_t threshold = (flags & UMORSE_CODE_DENSE) ? UMORSE_THRESHOLD_DENSE
+                                                   : UMORSE_THRESHOLD;
+    umorse_encoder_t enc;
+    size_t tpos = 0;
+    size_t cpos = 0;
+
+    if (clen < threshold) {
+        return -1;
+    }
+    _init_tables();
+    umorse_encoder_init(&enc, flags);
+    /* keep room for the final stop char to close code */
+    clen -= threshold;
+    while (tpos < tlen) {
+        size_t run = _ascii_run(text + tpos, tlen - tpos);
+        if (run > 0) {
+            size_t used = 0;
+            cpos += umorse_encoder_feed(&enc, text + tpos, run, &used,
+                                        code + cpos, clen - cpos);
+            tpos += used;
+            if (used < run) {
+                break;
+            }
+            continue;
+        }
+        uint32_t cp;
+        uint16_t mark;
+        size_t n = _next((const uint8_t *)text + tpos, tlen - tpos, &cp);
+        uint16_t cc = _lookup(cp, alphabets, &mark);
+        if (cc != UMORSE_SKIP) {
+            /* a kana and its sign are written both or none */
+            umorse_encoder_t prev = enc;
+            int res = umorse_encoder_put(&enc, cc, code + cpos, clen - cpos);
+            if (res < 0) {
+                break;
+            }
+            if (mark != UMORSE_SKIP) {
+                int sign = umorse_encoder_put(&enc, mark, code + cpos + res,
+                                              clen - cpos - res);
+                if (sign < 0) {
+                    enc = prev;
+                    break;
+                }
+                res += sign;
+            }
+            cpos += res;
+        }
+        tpos += n;
+    }
+    return cpos + umorse_encoder_finish(&enc, code + cpos,
+                                        clen + threshold - cpos);
+}
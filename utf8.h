@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 Sebastian Meiling <s@mlng.net>
+ *
+ * This file is part of uMorse, see
+ * https://github.com/smlng/uMorse
+ *
+ * This file is subject to the terms and conditions of the MIT License.
+ * See the file LICENSE in the top level directory for more details.
+ *
+ * If you did not receive a copy of the license file, see
+ * https://choosealicense.com/licenses/mit/
+ */
+
+/**
+ * @ingroup     umorse
+ * @{
+ * @file
+ * @brief       Definition of a uMorse encoder for UTF-8 text
+ *
+ * Encodes UTF-8 input with the Latin alphabet of symbols.h plus any of the
+ * Cyrillic, Greek and Wabun (Japanese kana) alphabets. Runs of ASCII are
+ * passed to umorse_encoder_feed as they are, so pure ASCII text encodes at
+ * the speed of umorse_encode. Other code points are looked up in a two
+ * level table of 64 code point blocks. Voiced kana are sent as their base
+ * kana followed by the dakuten or handakuten sign, small kana as the normal
+ * ones. Invalid, overlong and truncated sequences and code points without
+ * a code word are skipped, just as unknown bytes are in umorse_encode.
+ *
+ * @author      Sebastian Meiling <s@mlng.net>
+ */
+#ifndef UMORSE_UTF8_H
+#define UMORSE_UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @name Alphabets, besides Latin
+ * @{
+ */
+#define UMORSE_ALPHABET_CYRILLIC    (0x1)
+#define UMORSE_ALPHABET_GREEK       (0x2)
+#define UMORSE_ALPHABET_WABUN       (0x4)
+#define UMORSE_ALPHABET_ALL         (0x7)
+/** @} */
+
+/**
+ * @brief   Returns the code word of a single code point
+ *
+ * @param[in]   cp          Unicode code point
+ * @param[in]   alphabets   Alphabets to look up, see UMORSE_ALPHABET_*
+ * @param[out]  mark        Code word of a trailing dakuten or handakuten,
+ *                          UMORSE_SKIP for none, may be NULL
+ *
+ * @returns     code word, UMORSE_SKIP if @p cp has none
+ */
+uint16_t umorse_utf8_lookup(uint32_t cp, uint8_t alphabets, uint16_t *mark);
+
+/**
+ * @brief   Encodes a UTF-8 string into morse code
+ *
+ * @param[in]   text        Input text, UTF-8
+ * @param[in]   tlen        Length of input text in bytes
+ * @param[out]  code        Output buffer for encoded text
+ * @param[in]   clen        Length of output buffer
+ * @param[in]   flags       Optional flags, see umorse_encode
+ * @param[in]   alphabets   Alphabets to encode, see UMORSE_ALPHABET_*
+ *
+ * @returns     length of encoded text, including the final stop
+ * @returns     < 0 if the output buffer is too small for the final stop
+ */
+int umorse_utf8_encode(const char *text, size_t tlen, uint8_t *code,
+                       size_t clen, uint8_t flags, uint8_t alphabets);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UMORSE_UTF8_H */
+/** @} */